@@ -125,6 +125,38 @@ EOF
     echo "✓ Results saved to ${RESULT_FILE}"
 fi
 
+################################################################################
+# Step 4: Regression run with LUT pin swapping
+################################################################################
+
+echo ""
+echo "=== Step 4: Regression Run with LUT Pin Swapping ==="
+echo ""
+
+# The run must swap at least one LUT input, exit cleanly and write the routed netlist
+PINSWAP_OUTPUT_FILE="${PROJECT_ROOT}/benchmarks/${BENCHMARK}_routed_pinswap.phys"
+PINSWAP_LOG=/tmp/potter_pinswap_output.log
+rm -f "${PINSWAP_OUTPUT_FILE}"
+set +e
+"${BUILD_DIR}/route" \
+    -i "${BENCHMARK_FILE}" \
+    -o "${PINSWAP_OUTPUT_FILE}" \
+    -d "${DEVICE_FILE}" \
+    -t "${NUM_THREADS}" \
+    --lut_pin_swapping \
+    > "${PINSWAP_LOG}" 2>&1
+PINSWAP_STATUS=$?
+set -e
+
+# Count only the pins written to the netlist, printed once by dumpRoutingSolution
+PINSWAPS=$(grep -o "Swapped LUT pins: [0-9]*" "${PINSWAP_LOG}" | tail -n 1 | awk '{print $4}')
+PINSWAPS=${PINSWAPS:-0}
+if [ ${PINSWAP_STATUS} -ne 0 ] || [ ! -s "${PINSWAP_OUTPUT_FILE}" ] || [ "${PINSWAPS}" -eq 0 ]; then
+    echo "ERROR: pin swapping run failed (exit status ${PINSWAP_STATUS}, ${PINSWAPS} pins swapped), see ${PINSWAP_LOG}"
+    exit 1
+fi
+echo "✓ ${PINSWAPS} LUT inputs swapped, ${PINSWAP_OUTPUT_FILE} written"
+
 echo ""
 echo "=== Build and Test Complete ==="
 echo ""
@@ -0,0 +1,64 @@
+#include "potter.h"
+#include "route/aStarRoute.h"
+
+namespace potter {
+
+Design::Design(Device& device, int numThread) : database(device.getContext())
+{
+	database.setNumThread(numThread);
+	database.useRW = false;
+}
+
+void Design::readNetlist(const string& netlistFile)
+{
+	database.readNetlist(netlistFile);
+	buildRoutingGraph();
+}
+
+void Design::readNetlist(PhysicalNetlist::PhysNetlist::Reader netlist, const string& netlistName)
+{
+	database.readNetlist(netlist, netlistName);
+	buildRoutingGraph();
+}
+
+void Design::buildRoutingGraph()
+{
+	database.setRouteNodeChildren();
+	database.printStatistic();
+}
+
+/**
+ * @brief Route the design. The per-thread search data of the router is released before returning; only the routing result is kept for writing.
+ * The result is kept even if it is not legal (see aStarRoute::route()).
+ *
+ * @return true if the routing result is legal
+ */
+bool Design::route(const RouteOptions& options)
+{
+	assert_t(!isRouted);
+	aStarRoute router(database, options);
+	bool isLegal = router.route();
+	isRouted = true;
+	routingResults = std::move(router.nodeRoutingResults);
+	return isLegal;
+}
+
+bool Design::writeNetlist(const string& netlistFile)
+{
+	if (!isRouted) {
+		log(LOG_ERROR) << "The design is not routed. " << netlistFile << " is not written." << endl;
+		return false;
+	}
+	return database.writeNetlist(netlistFile, routingResults);
+}
+
+bool Design::writeNetlist(capnp::MessageBuilder& message)
+{
+	if (!isRouted) {
+		log(LOG_ERROR) << "The design is not routed." << endl;
+		return false;
+	}
+	return database.writeNetlist(message, routingResults);
+}
+
+}
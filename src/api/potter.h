@@ -0,0 +1,52 @@
+#pragma once
+#include "global.h"
+#include "db/deviceContext.h"
+#include "db/database.h"
+#include "route/routeOptions.h"
+
+/**
+ * @brief The embedding API of the router (libpotter).
+ * A Device is loaded once per process; each Design on it holds the complete per-design state, so designs can be routed one after another or concurrently.
+ * A netlist that cannot be read or written throws std::runtime_error; the router never exits the host process.
+ *
+ * 	potter::Device device("xcvu3p.device");
+ * 	potter::Design design(device, 32);
+ * 	design.readNetlist(unroutedReader);
+ * 	if (design.route())
+ * 		design.writeNetlist(routedMessage);
+ */
+namespace potter {
+
+class Device {
+public:
+	// imageFile: optional memory-mapped device image shared with other processes (see DeviceImage)
+	explicit Device(const string& deviceFile, const string& imageFile = "") {
+		context.imageFile = imageFile;
+		context.load(deviceFile);
+	}
+	DeviceContext& getContext() { return context; }
+
+private:
+	DeviceContext context;
+};
+
+class Design {
+public:
+	Design(Device& device, int numThread);
+	void readNetlist(const string& netlistFile);
+	void readNetlist(PhysicalNetlist::PhysNetlist::Reader netlist, const string& netlistName = "in-memory netlist");
+	bool route(const RouteOptions& options = RouteOptions()); // once per design
+	bool writeNetlist(const string& netlistFile); // false if not routed or if some pins are not routed
+	bool writeNetlist(capnp::MessageBuilder& message);
+
+	Database& getDatabase() { return database; }
+
+private:
+	void buildRoutingGraph();
+
+	Database database;
+	vector<RouteResult> routingResults;
+	bool isRouted = false;
+};
+
+}
@@ -14,6 +14,7 @@ public:
 	vector<int> getIndirectSinks() const {return indirectSinks;}
 	RouteNode* getIndirectSourceRNode() const {return indirectSourceRNode;}
 	vector<RouteNode*> getIndirectSinkRNodes() const {return indirectSinkRNodes;}
+	RouteNode* getIndirectSinkRNode(int i) const {return indirectSinkRNodes[i];} // the sink of the i-th connection
 	int getIndirectSourcePin() const {return indirectSourcePin;}
 	vector<int> getIndirectSinkPins() const {return indirectSinkPins;}
 	RouteNode* getIndirectSourcePinRNode() const {return indirectSourcePinRNode;}
@@ -66,6 +67,18 @@ public:
 			return false;
 		}
 	} 
+	// the number of (node, connection) uses of the net
+	long long countUsers() const {
+		long long cnt = 0;
+		for (const auto& user : usersConnectionCounts)
+			cnt += user.second;
+		return cnt;
+	}
+	void clearUsers() {
+		usersConnectionCounts.clear();
+		userConnectionToDecrement.clear();
+		userConnectionToIncrement.clear();
+	}
 	bool decrementUser(RouteNode* rnode) {
 		usersConnectionCounts[rnode] --;
 		if (usersConnectionCounts[rnode] == 0) {
@@ -193,6 +206,13 @@ public:
 		directSinkPinRNodes.emplace_back(n);
 		directSinkPins.emplace_back(n->getId());
 	}
+	// the sink of the i-th connection moved to an equivalent pin (--lut_pin_swapping); the int node of a swappable sink is its site pin node
+	void setIndirectSink(int i, RouteNode* n) {
+		indirectSinkRNodes[i] = n;
+		indirectSinks[i] = n->getId();
+		indirectSinkPinRNodes[i] = n;
+		indirectSinkPins[i] = n->getId();
+	}
 	void addConns(int conn) {indirectConns.emplace_back(conn);}
 	void addDirectConns(int conn) {directConns.emplace_back(conn);}
 	void addSubNetId(int subNetId) {subNetIds.emplace_back(subNetId);}
@@ -269,7 +289,7 @@ public:
 	// 	ymin = ymin_;
 	// 	ymax = ymax_;
 	// }
-	Connection(int id_, int netId_, int source_, int sink_) : id(id_), netId(netId_), source(source_), sink(sink_) {
+	Connection(int id_, int netId_, int source_, int sink_) : id(id_), netId(netId_), source(source_), sink(sink_), placedSink(sink_) {
 		rnodes.reserve(16);  // Reserve capacity to reduce dynamic reallocations
 	}
 	const utils::BoxT<int>& getBBox() const {return bbox;}
@@ -291,17 +311,22 @@ public:
 	int getRNodeSize() const {return rnodes.size();}
 	int getSource() const {return source;}
 	int getSink() const {return sink;}
+	int getPlacedSink() const {return placedSink;}
 	int getId() const {return id;}
 	// int getOriId() const {return oriId;}
 	RouteNode* getSourceRNode() const {return sourceRNode;}
 	RouteNode* getSinkRNode() const {return sinkRNode;}
 	RouteNode* getTargetRNode() const {return targetRNode;}
+	const vector<RouteNode*>& getEquivalentSinkRNodes() const {return equivalentSinkRNodes;}
 	bool isCrossSLR() const {return false;}
     vector<obj_idx> getIntToSinkPath() const {return intToSinkPath;}
     vector<obj_idx> getSourceToIntPath() const {return sourceToIntPath;}
 	int getNumNodesExplored() const {return numNodesExplored;}
 	int getLastRoutedIter() const {return lastRoutedIter;}
 	int getOriNetId() const {return oriNetId;}
+	int getXMargin() const {return xMargin;}
+	int getYMargin() const {return yMargin;}
+	int getBBoxStreak() const {return bboxStreak;}
 
 	void setNetId(int netId_) {netId = netId_;}
 	void setXMin(int v) {xmin = v;}
@@ -314,11 +339,17 @@ public:
 	void setSourceRNode(RouteNode* node) {sourceRNode = node;}
 	void setSinkRNode(RouteNode* node) {sinkRNode = node;}
 	void setTargetRNode(RouteNode* node) {targetRNode = node;}
+	void addEquivalentSinkRNode(RouteNode* node) {equivalentSinkRNodes.emplace_back(node);}
+	void clearEquivalentSinkRNodes() {equivalentSinkRNodes.clear();}
+	// equivalent sinks are only taken for a sink whose int node is its site pin node, so the path to the pin is the pin itself
+	void swapSink(RouteNode* node) {sink = node->getId(); sinkRNode = node; intToSinkPath = {node->getId()};}
 	void setIntToSinkPath(vector<obj_idx> intToSinkPath_) {intToSinkPath = intToSinkPath_;}
 	void setSourceToIntPath(vector<obj_idx> sourceToIntPath_) {sourceToIntPath = sourceToIntPath_;}
 	void setNumNodesExplored(int num) {numNodesExplored = num;}
 	void setLastRoutedIter(int iter) {lastRoutedIter = iter;}
 	void setOriNetId(int oriNetId_) {oriNetId = oriNetId_;}
+	void setMargins(int xMargin_, int yMargin_) {xMargin = xMargin_; yMargin = yMargin_;}
+	void setBBoxStreak(int streak) {bboxStreak = streak;}
 
 	void computeHPWL() {
 		hpwl = bbox.hp(); //TODO: use the location of source and sink nodes to compute HPWL instead of bbox
@@ -340,6 +371,7 @@ public:
 private:
 	int source;
 	int sink;
+	int placedSink; // the sink of the placed netlist; sink differs from it after a pin swap
 	int id;
 	int oriId; // original connection id in rapidWright
 	int netId; // the id from the indirect connection list; not the original id in rapdiwright
@@ -359,9 +391,15 @@ private:
 	RouteNode* sourceRNode = nullptr;
 	RouteNode* sinkRNode = nullptr;
 	RouteNode* targetRNode = nullptr;
+	vector<RouteNode*> equivalentSinkRNodes; // the placed sink and the pins it may be swapped to (--lut_pin_swapping); empty if not swappable
 
     vector<obj_idx> intToSinkPath;
     vector<obj_idx> sourceToIntPath;
 
 	int numNodesExplored = -1;
+
+	// bounding box margins; adapted per connection with --adaptive_bbox
+	int xMargin = 3;
+	int yMargin = 15;
+	int bboxStreak = 0; // > 0: iterations in a row failed or congested, < 0: iterations in a row routed without congestion
 };	
\ No newline at end of file
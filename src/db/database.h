@@ -6,6 +6,7 @@
 #include "utils/geo.h"
 #include "netlist.h"
 #include "device.h"
+#include "deviceContext.h"
 
 #include <thread>
 #include <fstream>
@@ -16,25 +17,37 @@
 
 class Database
 {
+	// per-design copies, used only if the device is shared (see DeviceContext)
+	std::unique_ptr<DeviceContext> ownedContext;
+	RouteNodeGraph jobRoutingGraph;
+	vector<int> jobNodesInGraph;
+
 public:
-	Database() : layout(0, 0, 108, 300), device(routingGraph), 
-		netlist(device, nets, indirectConnections, directConnections, preservedNodes, routingGraph, layout){}
+	Database();
+	Database(DeviceContext& sharedContext);
 	void readDevice(string deviceName);
 	void readNetlist(string netlistName);
-	void writeNetlist(string netlistName, const vector<RouteResult>& nodeRoutingResults) {netlist.write(netlistName, nodeRoutingResults);}
+	void readNetlist(PhysicalNetlist::PhysNetlist::Reader netlistReader, string netlistName);
+	// false if some pins are not routed; the netlist is written with them as stubs
+	bool writeNetlist(string netlistName, const vector<RouteResult>& nodeRoutingResults) {context.reloadNameData(); return netlist.write(netlistName, nodeRoutingResults);}
+	bool writeNetlist(capnp::MessageBuilder& message, const vector<RouteResult>& nodeRoutingResults) {context.reloadNameData(); return netlist.write(message, nodeRoutingResults);}
+	void releaseDeviceNames();
 	void reduceRouteNode();
 	void setRouteNodeChildren();
 	void printStatistic();
-	void checkRoute();
+	bool checkRoute();
 	void setNumThread(int n) { numThread = n; netlist.numThread = n; }
 	int getNumThread() {return numThread;}
+	void setLutPinSwapping(bool on) { netlist.lutPinSwapping = on; } // before readNetlist()
 
 	vector<Connection> indirectConnections;
 	vector<Connection> directConnections;
 	vector<Net> nets;
 	vector<bool> preservedNodes;
 
-	RouteNodeGraph routingGraph;
+	DeviceContext& context;
+	RouteNodeGraph& routingGraph;
+	vector<int>& nodesInGraph;
 	int numNodes = 0;
 	int numNodesInRRG = 0;
 	int numEdges = 0;
@@ -45,7 +58,7 @@ public:
 	int preservedNum = 0;
 	bool useRW = false;
 
-	Raw::Device device;
+	Raw::Device& device;
 	Raw::Netlist netlist;
 
 	std::string inputName;
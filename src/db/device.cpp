@@ -1,17 +1,42 @@
 #include <zlib.h>
 #include <unordered_set>
 #include "device.h"
+#include "deviceImage.h"
 
 #include <fstream>
 
 namespace Raw {
 
+WireRange Device::get_node_wires(obj_idx node_idx) const {
+    if (image != nullptr)
+        return {image->nodeWiresBegin(node_idx), image->nodeWiresEnd(node_idx)};
+    const vector<Wire>& wires = node_to_wires[node_idx];
+    return {wires.data(), wires.data() + wires.size()};
+}
+
+obj_idx Device::get_tile_wire_node(obj_idx tile_idx, obj_idx wire_idx) const {
+    if (image != nullptr)
+        return image->getTileWireNode(tile_idx, wire_idx);
+    return tile_wire_to_node[tile_idx][wire_idx];
+}
+
+/**
+ * @brief Switch to the tables of a device image and release the private copies
+ * 
+ */
+void Device::use_image(const DeviceImage* image_) {
+    assert_t(image_->getNodeNum() == nodeNum);
+    image = image_;
+    vector<vector<Wire>>().swap(node_to_wires);
+    vector<vector<obj_idx>>().swap(tile_wire_to_node);
+}
+
 vector<obj_idx> Device::get_outgoing_nodes(obj_idx node_idx) {
     vector<obj_idx> outgoing_nodes;
-    for (Wire& wire: node_to_wires[node_idx]) {
+    for (const Wire& wire: get_node_wires(node_idx)) {
         if (wire.tile_type_idx == NULL_TILE) continue;
         for (obj_idx child_wire_it_idx: tile_type_outgoing_wires[wire.tile_type_idx][wire.wire_in_tile_idx]) {
-            obj_idx child_idx = tile_wire_to_node[wire.tile_idx][child_wire_it_idx];
+            obj_idx child_idx = get_tile_wire_node(wire.tile_idx, child_wire_it_idx);
             if (child_idx != invalid_obj_idx) {
                 outgoing_nodes.emplace_back(child_idx);
             }
@@ -22,10 +47,11 @@ vector<obj_idx> Device::get_outgoing_nodes(obj_idx node_idx) {
 
 vector<obj_idx> Device::get_incoming_nodes(obj_idx node_idx) {
     vector<obj_idx> incoming_nodes;
-    for (obj_idx wire_idx = 0; wire_idx < node_to_wires[node_idx].size(); wire_idx++) {
-        Wire& wire = node_to_wires[node_idx][wire_idx];
+    WireRange wires = get_node_wires(node_idx);
+    for (obj_idx wire_idx = 0; wire_idx < wires.size(); wire_idx++) {
+        const Wire& wire = wires[wire_idx];
         for (obj_idx parent_wire_it_idx: tile_type_incoming_wires[wire.tile_type_idx][wire.wire_in_tile_idx]) {
-            obj_idx parent_idx = tile_wire_to_node[wire.tile_idx][parent_wire_it_idx];
+            obj_idx parent_idx = get_tile_wire_node(wire.tile_idx, parent_wire_it_idx);
             if (parent_idx != invalid_obj_idx) {
                 incoming_nodes.emplace_back(parent_idx);
                 // if (wire_idx != 0) {
@@ -68,7 +94,7 @@ obj_idx Device::get_site_pin_node(string site_name, string pin_name) const {
     obj_idx pin_idx = it->second;
     obj_idx tile_type_wire_idx = 
         tile_type_site_pin_to_wire_idx[site.tile_type_idx][site.in_tile_site_idx][pin_idx];
-    obj_idx node_idx = tile_wire_to_node[site.tile_idx][tile_type_wire_idx];
+    obj_idx node_idx = get_tile_wire_node(site.tile_idx, tile_type_wire_idx);
     return node_idx;
 }
 
@@ -831,6 +857,11 @@ void Device::read(std::string device_file)
 
 obj_idx Device::get_node_idx(obj_idx tile_idx, obj_idx wire_idx) 
 {
+    if (image != nullptr) {
+        if (tile_idx >= image->getTileNum()) return invalid_obj_idx;
+        if (wire_idx >= image->getTileWireNum(tile_idx)) return invalid_obj_idx;
+        return image->getTileWireNode(tile_idx, wire_idx);
+    }
     if (tile_idx >= tile_wire_to_node.size()) return invalid_obj_idx;
     if (wire_idx >= tile_wire_to_node[tile_idx].size()) return invalid_obj_idx;
     return tile_wire_to_node[tile_idx][wire_idx];
@@ -886,8 +917,8 @@ const TileTypePIP& Device::getTileTypePIP(obj_idx node0, obj_idx node1)
     obj_idx wire1_it_idx;
     bool found = false;
 
-    for (Wire& node1_wire: node_to_wires[node1]) {
-        for (Wire& node0_wire: node_to_wires[node0]) {
+    for (const Wire& node1_wire: get_node_wires(node1)) {
+        for (const Wire& node0_wire: get_node_wires(node0)) {
             if (node0_wire.tile_idx == node1_wire.tile_idx) {
                 // some nodes will have several segments in a tile
                 auto id = utils::ints2long(node0_wire.wire_in_tile_idx, node1_wire.wire_in_tile_idx);
@@ -909,14 +940,158 @@ const TileTypePIP& Device::getTileTypePIP(obj_idx node0, obj_idx node1)
     }
 
     unsigned long id = utils::ints2long(wire0_it_idx, wire1_it_idx);
-	assert_t(tile_type_node_pair_to_pip_idx[tile_type_idx].find(id) != tile_type_node_pair_to_pip_idx[tile_type_idx].end());
-	return tile_type_pip_list[tile_type_idx][tile_type_node_pair_to_pip_idx[tile_type_idx][id]];
+	auto it = tile_type_node_pair_to_pip_idx[tile_type_idx].find(id);
+	assert_t(it != tile_type_node_pair_to_pip_idx[tile_type_idx].end());
+	return tile_type_pip_list[tile_type_idx][it->second]; // lookup only, so designs sharing the device can write concurrently
 }
 
 void Device::dump() {
     
 }
 
+/**
+ * @brief Free the name and site lookup tables. Routing only works on node indices; loadNameData() brings them back for writing.
+ * 
+ */
+void Device::releaseNameData() {
+    vector<string>().swap(string_list);
+    unordered_map<string, int>().swap(string_to_idx);
+    vector<str_idx>().swap(tile_to_name_idx);
+    vector<vector<str_idx>>().swap(tile_type_wire_to_name_idx);
+    vector<unordered_map<string, obj_idx>>().swap(site_type_pin_name_to_idx);
+    unordered_map<string, obj_idx>().swap(site_name_to_idx);
+    vector<Site>().swap(sites);
+    vector<vector<vector<obj_idx>>>().swap(tile_type_site_pin_to_wire_idx);
+    vector<unordered_map<str_idx, obj_idx>>().swap(tile_type_wire_str_to_idx);
+    unordered_map<str_idx, obj_idx>().swap(tile_str_to_idx);
+    unordered_map<string, obj_idx>().swap(tile_name_to_idx);
+    unordered_map<string, obj_idx>().swap(tile_name_to_type);
+    vector<unordered_map<string, obj_idx>>().swap(wire_name_to_idx_in_tile_type);
+}
+
+namespace {
+// written before the name tables, so that a dump of another device or device build is never loaded
+struct NameDataHeader {
+    static const int currentVersion = 1;
+    int version = currentVersion;
+    string deviceName;
+    int nodeNum = 0;
+    uint64_t nameHash = 0;
+
+    bool matches(const string& deviceName_, int nodeNum_, uint64_t nameHash_) const {
+        return version == currentVersion && deviceName == deviceName_ && nodeNum == nodeNum_ && nameHash == nameHash_;
+    }
+    template<class Archive>
+    void serialize(Archive & ar, const unsigned int) {
+        ar & version;
+        ar & deviceName;
+        ar & nodeNum;
+        ar & nameHash;
+    }
+};
+}
+
+uint64_t Device::hashNameData() const {
+    uint64_t hash = 1469598103934665603ULL;
+    auto mix = [&hash](uint64_t v) {
+        hash ^= v;
+        hash *= 1099511628211ULL;
+    };
+    mix(string_list.size());
+    for (const auto& s : string_list) mix(s.size());
+    mix(tile_to_name_idx.size());
+    for (const auto& names : tile_type_wire_to_name_idx) mix(names.size());
+    mix(site_type_pin_name_to_idx.size());
+    mix(site_name_to_idx.size());
+    mix(sites.size());
+    for (const auto& sitePins : tile_type_site_pin_to_wire_idx) mix(sitePins.size());
+    mix(tile_type_wire_str_to_idx.size());
+    mix(tile_str_to_idx.size());
+    mix(tile_name_to_idx.size());
+    mix(tile_name_to_type.size());
+    mix(wire_name_to_idx_in_tile_type.size());
+    return hash;
+}
+
+/**
+ * @brief Write the name tables behind a header of the device name, nodeNum and hashNameData()
+ *
+ * @return false if the file could not be written completely
+ */
+bool Device::dumpNameData(const string& file, const string& deviceName) {
+    std::ofstream ofs(file, std::ios::binary);
+    if (!ofs) return false;
+    {
+        boost::archive::binary_oarchive oa(ofs);
+        NameDataHeader header;
+        header.deviceName = deviceName;
+        header.nodeNum = nodeNum;
+        header.nameHash = hashNameData();
+        oa & header;
+        serializeNameData(oa);
+    }
+    ofs.close();
+    return !ofs.fail();
+}
+
+// true if file is a name dump of this device whose header matches nameHash
+bool Device::hasNameDataFile(const string& file, const string& deviceName, uint64_t nameHash) const {
+    std::ifstream ifs(file, std::ios::binary);
+    if (!ifs) return false;
+    try {
+        boost::archive::binary_iarchive ia(ifs);
+        NameDataHeader header;
+        ia & header;
+        return header.matches(deviceName, nodeNum, nameHash);
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+/**
+ * @brief Load the name tables dumped by dumpNameData()
+ *
+ * @return false, with no name tables, if the file is missing, of another device, or unreadable
+ */
+bool Device::loadNameData(const string& file, const string& deviceName, uint64_t nameHash) {
+    std::ifstream ifs(file, std::ios::binary);
+    if (!ifs) return false;
+    try {
+        boost::archive::binary_iarchive ia(ifs);
+        NameDataHeader header;
+        ia & header;
+        if (!header.matches(deviceName, nodeNum, nameHash))
+            return false;
+        serializeNameData(ia);
+    } catch (const std::exception& e) {
+        log(LOG_ERROR) << "Failed to read device names " << file << ": " << e.what() << endl;
+        releaseNameData();
+        return false;
+    }
+    if (hashNameData() != nameHash) {
+        releaseNameData();
+        return false;
+    }
+    return true;
+}
+
+// move the name tables of another device of the same device file
+void Device::takeNameData(Device& other) {
+    string_list.swap(other.string_list);
+    string_to_idx.swap(other.string_to_idx);
+    tile_to_name_idx.swap(other.tile_to_name_idx);
+    tile_type_wire_to_name_idx.swap(other.tile_type_wire_to_name_idx);
+    site_type_pin_name_to_idx.swap(other.site_type_pin_name_to_idx);
+    site_name_to_idx.swap(other.site_name_to_idx);
+    sites.swap(other.sites);
+    tile_type_site_pin_to_wire_idx.swap(other.tile_type_site_pin_to_wire_idx);
+    tile_type_wire_str_to_idx.swap(other.tile_type_wire_str_to_idx);
+    tile_str_to_idx.swap(other.tile_str_to_idx);
+    tile_name_to_idx.swap(other.tile_name_to_idx);
+    tile_name_to_type.swap(other.tile_name_to_type);
+    wire_name_to_idx_in_tile_type.swap(other.wire_name_to_idx_in_tile_type);
+}
+
 Device::~Device() {
     log() << "Device destruct" << endl;
 }
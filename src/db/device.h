@@ -6,6 +6,8 @@
 #include "DeviceResources.capnp.h"
 #include "db/routeNodeGraph.h"
 
+class DeviceImage;
+
 namespace Raw {
 
 class Node {
@@ -120,6 +122,16 @@ public:
     }
 };
 
+class WireRange {
+public:
+    const Wire* first;
+    const Wire* last;
+    const Wire* begin() const {return first;}
+    const Wire* end() const {return last;}
+    size_t size() const {return last - first;}
+    const Wire& operator[](size_t i) const {return first[i];}
+};
+
 class Device {
 public:
     // Device(string device_file);
@@ -141,7 +153,7 @@ public:
     int edgeNum;
     vector<bool> node_in_allowed_tile;
 	vector<int> nodes_in_graph;
-	vector<NodeInfo> nodeInfos;
+	utils::huge_vector<NodeInfo> nodeInfos;
     vector<string> string_list;
     unordered_map<string, int> string_to_idx;
     vector<str_idx> tile_to_name_idx;
@@ -158,6 +170,11 @@ public:
     // string get_tile_wire_name(obj_idx tile_idx, obj_idx wire_idx) {return (get_tile_name(tile_idx) + "/" + get_wire_name(tile_idx, wire_idx));}
 
     vector<vector<Wire>> node_to_wires;
+    // node -> wires and tile wire -> node, served by the shared device image once it is attached
+    WireRange get_node_wires(obj_idx node_idx) const;
+    obj_idx get_tile_wire_node(obj_idx tile_idx, obj_idx wire_idx) const;
+    const vector<vector<obj_idx>>& get_tile_wire_to_node() const {return tile_wire_to_node;}
+    void use_image(const DeviceImage* image_);
     vector<vector<vector<obj_idx>>> tile_type_outgoing_wires;           // tile_type_idx -> tile_type_w0_idx -> list(tile_type_w1_idx)
     vector<vector<vector<obj_idx>>> tile_type_incoming_wires;           // tile_type_idx -> tile_type_w1_idx -> list(tile_type_w0_idx)
     vector<vector<TileTypePIP>> tile_type_pip_list;
@@ -165,6 +182,16 @@ public:
     // vector<string> node_names;
 	void clearData(int i);
 
+    // name data: only needed to resolve and write netlists, so it can be dropped while routing ->
+    bool hasNameData() const {return !string_list.empty();}
+    void releaseNameData();
+    uint64_t hashNameData() const; // a fingerprint of the table sizes, checked by the header of a name dump
+    bool dumpNameData(const string& file, const string& deviceName);
+    bool hasNameDataFile(const string& file, const string& deviceName, uint64_t nameHash) const;
+    bool loadNameData(const string& file, const string& deviceName, uint64_t nameHash);
+    void takeNameData(Device& other);
+    // name data <-
+
     // get shape of the device
     int getDeviceXMax() {return x_max;}
     int getDeviceYMax() {return y_max;}
@@ -174,6 +201,7 @@ private:
     int y_max = 0;
     // for indexing
 	RouteNodeGraph& routingGraph;
+    const DeviceImage* image = nullptr;
     vector<vector<obj_idx>> tile_wire_to_node; // tile_idx, wire_idx -> node_idx
     vector<unordered_map<string, obj_idx>> site_type_pin_name_to_idx; // site_idx -> pin_name : pin_idx
     unordered_map<string, obj_idx> site_name_to_idx; //
@@ -226,6 +254,24 @@ private:
         ar & wire_name_to_idx_in_tile_type;
     }
 
+    template<class Archive>
+    void serializeNameData(Archive & ar)
+    {
+        ar & string_list;
+        ar & string_to_idx;
+        ar & tile_to_name_idx;
+        ar & tile_type_wire_to_name_idx;
+        ar & site_type_pin_name_to_idx;
+        ar & site_name_to_idx;
+        ar & sites;
+        ar & tile_type_site_pin_to_wire_idx;
+        ar & tile_type_wire_str_to_idx;
+        ar & tile_str_to_idx;
+        ar & tile_name_to_idx;
+        ar & tile_name_to_type;
+        ar & wire_name_to_idx_in_tile_type;
+    }
+
     void add_edge(obj_idx start_node, obj_idx end_node, obj_idx tile_col, obj_idx tile_row, obj_idx pip_idx);
     void add_pip(obj_idx start_node, obj_idx end_node, obj_idx tile_idx, obj_idx wire0_idx, obj_idx wire1_idx, bool directional);
     
@@ -0,0 +1,275 @@
+#include "deviceContext.h"
+
+#include <malloc.h>
+#include <unistd.h>
+#include <stdexcept>
+
+void DeviceContext::load(string deviceName_) {
+    deviceName = deviceName_;
+    size_t pos = deviceName.rfind('/');
+    string deviceDir = (pos == deviceName.npos) ? "." : deviceName.substr(0, pos);
+    string dumpDir = deviceDir + "/dump";
+    string dumpDevice = deviceDir + "/dump/device";
+    // string dumpNodeToWires = deviceDir + "/dump/node_to_wires";
+    string dumpNodeToWires0 = deviceDir + "/dump/node_to_wires0";
+    string dumpNodeToWires1 = deviceDir + "/dump/node_to_wires1";
+    string dumpNodeToWires2 = deviceDir + "/dump/node_to_wires2";
+    string dumpNodeToWires3 = deviceDir + "/dump/node_to_wires3";
+    string dumpRouteNodes = deviceDir + "/dump/routeNodes";
+    nameDataFile = deviceDir + "/dump/device_names";
+    // std::cout << dumpDevice << " " << dumpRouteNodes << endl;
+
+    auto isFileExists_stat = [](string& name) {
+        struct stat buffer;   
+        return (stat(name.c_str(), &buffer) == 0); 
+    };
+
+    if (isFileExists_stat(dumpDevice) && 
+        isFileExists_stat(dumpRouteNodes) && 
+        isFileExists_stat(dumpNodeToWires0) &&
+        isFileExists_stat(dumpNodeToWires1) &&
+        isFileExists_stat(dumpNodeToWires2) &&
+        isFileExists_stat(dumpNodeToWires3)) {
+        vector<vector<Raw::Wire>> node_to_wires0;
+        vector<vector<Raw::Wire>> node_to_wires1;
+        vector<vector<Raw::Wire>> node_to_wires2;
+        vector<vector<Raw::Wire>> node_to_wires3;
+        vector<RouteNode> routeNode0;
+        vector<RouteNode> routeNode1;
+        vector<RouteNode> routeNode2;
+        vector<RouteNode> routeNode3;
+        auto load_node_to_wires0 = [&] {
+            // log() << "start load_node_to_wires0" << endl;
+            std::ifstream ifs;
+            ifs.open(dumpNodeToWires0);
+            boost::archive::binary_iarchive ia_node_to_wires(ifs);
+            ia_node_to_wires & node_to_wires0;
+            ifs.close();
+            // log() << "end load_node_to_wires0" << endl;
+        };
+        auto load_node_to_wires1 = [&] {
+            // log() << "start load_node_to_wires1" << endl;
+            std::ifstream ifs;
+            ifs.open(dumpNodeToWires1);
+            boost::archive::binary_iarchive ia_node_to_wires(ifs);
+            ia_node_to_wires & node_to_wires1;
+            ifs.close();
+            // log() << "end load_node_to_wires1" << endl;
+        };
+        auto load_node_to_wires2 = [&] {
+            // log() << "start load_node_to_wires2" << endl;
+            std::ifstream ifs;
+            ifs.open(dumpNodeToWires2);
+            boost::archive::binary_iarchive ia_node_to_wires(ifs);
+            ia_node_to_wires & node_to_wires2;
+            ifs.close();
+            // log() << "end load_node_to_wires2" << endl;
+        };
+        auto load_node_to_wires3 = [&] {
+            // log() << "start load_node_to_wires3" << endl;
+            std::ifstream ifs;
+            ifs.open(dumpNodeToWires3);
+            boost::archive::binary_iarchive ia_node_to_wires(ifs);
+            ia_node_to_wires & node_to_wires3;
+            ifs.close();
+            // log() << "end load_node_to_wires3" << endl;
+        };
+        auto load_device = [&] {
+            std::ifstream ifs;
+            ifs.open(dumpDevice);
+            boost::archive::binary_iarchive ia_device(ifs);
+            ia_device & device;
+            ifs.close();
+        };
+        auto load_routeNodes = [&] {
+            // log() << "start load_routeNodes3" << endl;
+            std::ifstream ifs;
+            ifs.open(dumpRouteNodes);
+            boost::archive::binary_iarchive ia_routeNodes(ifs);
+            ia_routeNodes & routingGraph.routeNodes;
+            ifs.close();
+            // log() << "end load_routeNodes3" << endl;
+        };
+        log() << "Device cache is found. Start loading." << endl;
+        auto concat_node_to_wires = [&] {
+            std::thread thread_node_to_wires0(load_node_to_wires0);
+            std::thread thread_node_to_wires1(load_node_to_wires1);
+            std::thread thread_node_to_wires2(load_node_to_wires2);
+            std::thread thread_node_to_wires3(load_node_to_wires3);
+            thread_node_to_wires0.join();
+            thread_node_to_wires1.join();
+            thread_node_to_wires2.join();
+            thread_node_to_wires3.join();
+            // log() << "start concat_node_to_wires" << endl;
+            device.node_to_wires.reserve((node_to_wires0.size() + node_to_wires1.size() + node_to_wires2.size() + node_to_wires3.size()));
+            device.node_to_wires.insert(device.node_to_wires.end(), node_to_wires0.begin(), node_to_wires0.end());
+            device.node_to_wires.insert(device.node_to_wires.end(), node_to_wires1.begin(), node_to_wires1.end());
+            device.node_to_wires.insert(device.node_to_wires.end(), node_to_wires2.begin(), node_to_wires2.end());
+            device.node_to_wires.insert(device.node_to_wires.end(), node_to_wires3.begin(), node_to_wires3.end());
+            // log() << "end concat_node_to_wires" << endl;
+        };
+        // node_to_wires is not needed if another process has already built the device image
+        bool imageAttached = !imageFile.empty() && image.attach(imageFile);
+        std::thread thread_device(load_device);
+        std::thread thread_routeNodes(load_routeNodes);
+        std::thread thread_concat_node_to_wires;
+        if (!imageAttached)
+            thread_concat_node_to_wires = std::thread(concat_node_to_wires);
+        // std::thread thread_concat_routeNodes(concat_routeNodes);
+        thread_device.join();
+        if (thread_concat_node_to_wires.joinable())
+            thread_concat_node_to_wires.join();
+        thread_routeNodes.join();
+        if (imageAttached && image.getFingerprint() != DeviceImage::fingerprint(device)) {
+            log() << "Device image " << imageFile << " belongs to another device. Rebuild it." << endl;
+            image.detach();
+            concat_node_to_wires();
+        }
+        assert_t(image.isAttached() || device.node_to_wires.size() == device.nodeNum);
+        assert_t(routingGraph.routeNodes.size() == device.nodeNum);
+        log() << "Finish loading." << endl;
+    } else {
+        device.read(deviceName);
+        {
+            if (!isFileExists_stat(dumpDir)) mkdir(dumpDir.c_str(), S_IRWXU | S_IRUSR | S_IWUSR | S_IXUSR | S_IRWXG | S_IRWXO);
+            auto dump_node_to_wires0 = [&]() {
+                vector<vector<Raw::Wire>> node_to_wires0;
+                // node_to_wires0.reserve(device.node_to_wires.size() / 4);
+                auto it_begin = device.node_to_wires.begin();
+                auto it_end = device.node_to_wires.begin() + device.node_to_wires.size() / 4;
+                node_to_wires0.insert(node_to_wires0.end(), it_begin, it_end);
+                std::ofstream ofs;
+                ofs.open(dumpNodeToWires0);
+                boost::archive::binary_oarchive oa_node_to_wires(ofs);
+                oa_node_to_wires & node_to_wires0;
+                ofs.close();
+            };
+            auto dump_node_to_wires1 = [&]() {
+                vector<vector<Raw::Wire>> node_to_wires1;
+                // node_to_wires1.reserve(device.node_to_wires.size() / 4);
+                auto it_begin = device.node_to_wires.begin() + device.node_to_wires.size() / 4;
+                auto it_end = device.node_to_wires.begin() + 2 * device.node_to_wires.size() / 4;
+                node_to_wires1.insert(node_to_wires1.end(), it_begin, it_end);
+                std::ofstream ofs;
+                ofs.open(dumpNodeToWires1);
+                boost::archive::binary_oarchive oa_node_to_wires(ofs);
+                oa_node_to_wires & node_to_wires1;
+                ofs.close();
+            };
+            auto dump_node_to_wires2 = [&]() {
+                vector<vector<Raw::Wire>> node_to_wires2;
+                // node_to_wires2.reserve(device.node_to_wires.size() / 4);
+                auto it_begin = device.node_to_wires.begin() + 2 * device.node_to_wires.size() / 4;
+                auto it_end = device.node_to_wires.begin() + 3 * device.node_to_wires.size() / 4;
+                node_to_wires2.insert(node_to_wires2.end(), it_begin, it_end);
+                std::ofstream ofs;
+                ofs.open(dumpNodeToWires2);
+                boost::archive::binary_oarchive oa_node_to_wires(ofs);
+                oa_node_to_wires & node_to_wires2;
+                ofs.close();
+            };
+            auto dump_node_to_wires3 = [&]() {
+                vector<vector<Raw::Wire>> node_to_wires3;
+                // node_to_wires3.reserve(device.node_to_wires.size() - 3 * device.node_to_wires.size() / 4);
+                auto it_begin = device.node_to_wires.begin() + 3 * device.node_to_wires.size() / 4;
+                auto it_end = device.node_to_wires.end();
+                node_to_wires3.insert(node_to_wires3.end(), it_begin, it_end);
+                std::ofstream ofs;
+                ofs.open(dumpNodeToWires3);
+                boost::archive::binary_oarchive oa_node_to_wires(ofs);
+                oa_node_to_wires & node_to_wires3;
+                ofs.close();
+            };
+            auto dump_device = [&]() {
+                std::ofstream ofs;
+                ofs.open(dumpDevice);
+                boost::archive::binary_oarchive oa_device(ofs);
+                oa_device & device;
+                ofs.close();
+            };
+            auto dump_routenodes = [&]() {
+                std::ofstream ofs;
+                ofs.open(dumpRouteNodes);
+                boost::archive::binary_oarchive oa_routeNodes(ofs);
+                oa_routeNodes & routingGraph.routeNodes;
+                ofs.close();
+            };
+
+            log() << "Dump device cache to the disk." << endl;
+            std::thread thread_node_to_wires0(dump_node_to_wires0);
+            std::thread thread_node_to_wires1(dump_node_to_wires1);
+            std::thread thread_node_to_wires2(dump_node_to_wires2);
+            std::thread thread_node_to_wires3(dump_node_to_wires3);
+            std::thread thread_device(dump_device);
+            std::thread thread_routeNodes(dump_routenodes);
+            thread_node_to_wires0.join();
+            thread_node_to_wires1.join();
+            thread_node_to_wires2.join();
+            thread_node_to_wires3.join();
+            thread_device.join();
+            thread_routeNodes.join();
+            log() << "Finish dumping." << endl;
+        }
+    }
+    if (!imageFile.empty())
+        shareDeviceTables();
+}
+
+/**
+ * @brief Serve the node/wire tables from the memory-mapped device image and drop the private copies.
+ * The first process builds the image; later processes only map it.
+ */
+void DeviceContext::shareDeviceTables() {
+    bool isValid = image.isAttached() || image.attach(imageFile);
+    if (isValid && image.getFingerprint() != DeviceImage::fingerprint(device))
+        isValid = false; // stale image of another device or device build
+    if (!isValid && !(DeviceImage::build(imageFile, device) && image.attach(imageFile))) {
+        log(LOG_ERROR) << "Cannot use device image " << imageFile << ". Keep the device tables private." << endl;
+        return;
+    }
+    device.use_image(&image);
+}
+
+/**
+ * @brief Drop the name and site tables of the device before routing. They are dumped next to the device cache the first time.
+ * Only for a context owned by one design: a shared context may be parsing another netlist.
+ */
+void DeviceContext::releaseNameData() {
+    if (!device.hasNameData()) return;
+    nameDataHash = device.hashNameData();
+    if (!device.hasNameDataFile(nameDataFile, deviceName, nameDataHash)) {
+        // missing, or left by another device build
+        string tmpFile = nameDataFile + ".tmp." + std::to_string(getpid());
+        if (!device.dumpNameData(tmpFile, deviceName) || rename(tmpFile.c_str(), nameDataFile.c_str()) != 0) {
+            log(LOG_WARN) << "Cannot dump device names to " << nameDataFile << ". Keep them in memory." << endl;
+            remove(tmpFile.c_str());
+            return;
+        }
+    }
+    double memBefore = utils::mem_use::get_current();
+    device.releaseNameData();
+    malloc_trim(0); // hand the freed heap back to the system for routing
+    log() << "Released device names: " << std::fixed << std::setprecision(0) << memBefore - utils::mem_use::get_current() << " MB" << endl;
+}
+
+/**
+ * @brief Bring the name tables back after releaseNameData(), just before writing the netlist.
+ * If the dump cannot be loaded, the names are read again from the device file, so that the routing result is never lost.
+ */
+void DeviceContext::reloadNameData() {
+    if (device.hasNameData()) return;
+    utils::timer timer;
+    if (device.loadNameData(nameDataFile, deviceName, nameDataHash)) {
+        log() << "Reloaded device names in " << std::fixed << std::setprecision(2) << timer.elapsed() << "s" << endl;
+        return;
+    }
+    log(LOG_WARN) << "Cannot reload device names from " << nameDataFile << ". Read them from " << deviceName << "." << endl;
+    remove(nameDataFile.c_str()); // dumped again by the next run
+    RouteNodeGraph scratchGraph;
+    Raw::Device scratch(scratchGraph);
+    scratch.read(deviceName);
+    if (scratch.hashNameData() != nameDataHash)
+        throw std::runtime_error("device " + deviceName + " changed during routing");
+    device.takeNameData(scratch);
+    log() << "Read device names in " << std::fixed << std::setprecision(2) << timer.elapsed() << "s" << endl;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "global.h"
+#include "routeNodeGraph.h"
+#include "device.h"
+#include "deviceImage.h"
+
+#include <thread>
+#include <fstream>
+#include <sys/stat.h>
+
+/**
+ * @brief The device and its routing graph as loaded from the device file (or its dump cache).
+ * A context can be shared by many designs: each Database built on it copies what routing a design modifies and only reads the rest.
+ */
+class DeviceContext
+{
+public:
+	DeviceContext() : device(routingGraph) {}
+	void load(string deviceName_);
+	void releaseNameData();
+	void reloadNameData();
+
+	RouteNodeGraph routingGraph;
+	Raw::Device device;
+	string deviceName;
+	string imageFile = ""; // set before load() to share the node/wire tables with other processes
+
+private:
+	DeviceImage image;
+	string nameDataFile; // dump of the name tables, the source of reloadNameData()
+	uint64_t nameDataHash = 0; // Device::hashNameData() of the released tables
+	void shareDeviceTables();
+};
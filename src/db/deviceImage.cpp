@@ -0,0 +1,149 @@
+#include "deviceImage.h"
+#include <fstream>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static_assert(std::is_trivially_copyable<Raw::Wire>::value, "Raw::Wire is stored in the device image as raw bytes");
+
+namespace {
+size_t align8(size_t n) { return (n + 7) & ~(size_t)7; }
+}
+
+/**
+ * @brief Hash the tile wire -> node table of a device, with its node and edge counts. node -> wires is its inverse, so the hash
+ * identifies the content of the image. The table is loaded by every process, also by those that attach an image.
+ */
+uint64_t DeviceImage::fingerprint(const Raw::Device& device)
+{
+	uint64_t hash = 1469598103934665603ULL;
+	auto mix = [&hash](uint64_t v) {
+		hash ^= v;
+		hash *= 1099511628211ULL;
+	};
+	mix(device.nodeNum);
+	mix(device.edgeNum);
+	for (const auto& tileWires : device.get_tile_wire_to_node()) {
+		mix(tileWires.size());
+		for (obj_idx node : tileWires)
+			mix(node);
+	}
+	return hash;
+}
+
+/**
+ * @brief Write the image of device.node_to_wires and device.tile_wire_to_node.
+ * The file is written under a temporary name and renamed, so concurrent processes never attach a partial image.
+ */
+bool DeviceImage::build(const string& fileName, const Raw::Device& device)
+{
+	const auto& nodeToWires = device.node_to_wires;
+	const auto& tileWireToNode = device.get_tile_wire_to_node();
+	if (nodeToWires.size() != device.nodeNum) {
+		log(LOG_ERROR) << "Device image needs node_to_wires of all " << device.nodeNum << " nodes" << endl;
+		return false;
+	}
+
+	Header hdr = {};
+	hdr.magic = magic;
+	hdr.version = version;
+	hdr.nodeNum = device.nodeNum;
+	hdr.tileNum = tileWireToNode.size();
+	hdr.fingerprint = fingerprint(device);
+	vector<uint32_t> nodeOffsets(hdr.nodeNum + 1, 0);
+	for (size_t i = 0; i < nodeToWires.size(); i ++)
+		nodeOffsets[i + 1] = nodeOffsets[i] + nodeToWires[i].size();
+	vector<uint32_t> tileOffsets(hdr.tileNum + 1, 0);
+	for (size_t i = 0; i < tileWireToNode.size(); i ++)
+		tileOffsets[i + 1] = tileOffsets[i] + tileWireToNode[i].size();
+	hdr.wireNum = nodeOffsets.back();
+	hdr.tileWireNum = tileOffsets.back();
+
+	string tmpName = fileName + ".tmp." + std::to_string(getpid());
+	{
+		std::ofstream ofs(tmpName, std::ios::binary);
+		if (!ofs) {
+			log(LOG_ERROR) << "Cannot open device image " << tmpName << endl;
+			return false;
+		}
+		const char zeros[8] = {};
+		auto writeArray = [&ofs, &zeros](const void* data, size_t bytes) {
+			ofs.write((const char*)data, bytes);
+			ofs.write(zeros, align8(bytes) - bytes);
+		};
+		writeArray(&hdr, sizeof(hdr));
+		writeArray(nodeOffsets.data(), nodeOffsets.size() * sizeof(uint32_t));
+		for (const auto& nodeWires : nodeToWires)
+			ofs.write((const char*)nodeWires.data(), nodeWires.size() * sizeof(Raw::Wire));
+		ofs.write(zeros, align8(hdr.wireNum * sizeof(Raw::Wire)) - hdr.wireNum * sizeof(Raw::Wire));
+		writeArray(tileOffsets.data(), tileOffsets.size() * sizeof(uint32_t));
+		for (const auto& tileWires : tileWireToNode)
+			ofs.write((const char*)tileWires.data(), tileWires.size() * sizeof(obj_idx));
+		if (!ofs) {
+			log(LOG_ERROR) << "Failed to write device image " << tmpName << endl;
+			return false;
+		}
+	}
+	std::error_code ec;
+	std::filesystem::rename(tmpName, fileName, ec);
+	if (ec) {
+		log(LOG_ERROR) << "Failed to move device image " << tmpName << " to " << fileName << ": " << ec.message() << endl;
+		return false;
+	}
+	log() << "Device image " << fileName << " is built: " << hdr.wireNum << " node wires, " << hdr.tileWireNum << " tile wires" << endl;
+	return true;
+}
+
+bool DeviceImage::attach(const string& fileName)
+{
+	detach();
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)) {
+		close(fd);
+		return false;
+	}
+	void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED)
+		return false;
+	base = addr;
+	size = st.st_size;
+
+	const char* p = (const char*)base;
+	header = (const Header*)p;
+	if (header->magic != magic || header->version != version) {
+		log(LOG_ERROR) << "Device image " << fileName << " has an unknown format" << endl;
+		detach();
+		return false;
+	}
+	p += align8(sizeof(Header));
+	nodeWireOffsets = (const uint32_t*)p;
+	p += align8((header->nodeNum + 1) * sizeof(uint32_t));
+	wires = (const Raw::Wire*)p;
+	p += align8(header->wireNum * sizeof(Raw::Wire));
+	tileWireOffsets = (const uint32_t*)p;
+	p += align8((header->tileNum + 1) * sizeof(uint32_t));
+	tileWireNodes = (const obj_idx*)p;
+	p += header->tileWireNum * sizeof(obj_idx);
+	if (p > (const char*)base + size) {
+		log(LOG_ERROR) << "Device image " << fileName << " is truncated" << endl;
+		detach();
+		return false;
+	}
+	log() << "Attached device image " << fileName << " (" << size / (1024 * 1024) << " MB)" << endl;
+	return true;
+}
+
+void DeviceImage::detach()
+{
+	if (base != nullptr)
+		munmap(base, size);
+	base = nullptr;
+	size = 0;
+	header = nullptr;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "global.h"
+#include "device.h"
+
+/**
+ * @brief A read-only, memory-mapped image of the largest device tables (node -> wires and tile wire -> node) in flat CSR form.
+ * The first process builds the file; every later process maps the same pages instead of holding a private copy.
+ * Placing the file on /dev/shm makes it a POSIX shared-memory segment.
+ * The route nodes and the routing graph are not in the image: each design sets the types of its pin nodes and prunes the graph
+ * with its own pins, so every process keeps them private.
+ */
+class DeviceImage
+{
+public:
+	static const uint64_t magic = 0x4547414d49564450ULL; // "PDVIMAGE"
+	static const uint32_t version = 2;
+
+	DeviceImage() {}
+	~DeviceImage() { detach(); }
+	DeviceImage(const DeviceImage&) = delete;
+	DeviceImage& operator=(const DeviceImage&) = delete;
+
+	static bool build(const string& fileName, const Raw::Device& device);
+	static uint64_t fingerprint(const Raw::Device& device); // of the device build, stored in the header
+	bool attach(const string& fileName);
+	void detach();
+	bool isAttached() const { return base != nullptr; }
+
+	uint32_t getNodeNum() const { return header->nodeNum; }
+	uint64_t getFingerprint() const { return header->fingerprint; }
+	uint32_t getTileNum() const { return header->tileNum; }
+	const Raw::Wire* nodeWiresBegin(obj_idx node) const { return wires + nodeWireOffsets[node]; }
+	const Raw::Wire* nodeWiresEnd(obj_idx node) const { return wires + nodeWireOffsets[node + 1]; }
+	uint32_t getTileWireNum(obj_idx tile) const { return tileWireOffsets[tile + 1] - tileWireOffsets[tile]; }
+	obj_idx getTileWireNode(obj_idx tile, obj_idx wire) const { return tileWireNodes[tileWireOffsets[tile] + wire]; }
+
+private:
+	struct Header {
+		uint64_t magic;
+		uint32_t version;
+		uint32_t nodeNum;
+		uint32_t tileNum;
+		uint32_t reserved;
+		uint64_t wireNum;
+		uint64_t tileWireNum;
+		uint64_t fingerprint;
+	};
+
+	void* base = nullptr;
+	size_t size = 0;
+	const Header* header = nullptr;
+	const uint32_t* nodeWireOffsets = nullptr;
+	const Raw::Wire* wires = nullptr;
+	const uint32_t* tileWireOffsets = nullptr;
+	const obj_idx* tileWireNodes = nullptr;
+};
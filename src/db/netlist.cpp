@@ -1,5 +1,8 @@
 #include "netlist.h"
 #include <queue>
+#include <map>
+#include <algorithm>
+#include <stdexcept>
 #include <fstream>
 #include <string>
 #include <thread>
@@ -13,12 +16,33 @@ void Netlist::read(std::string netlist_file)
     log() << std::endl;
 	parseNetlist(netlist_file);
 	updateNetAndConnectionBBox();
+	printStatistic();
+}
+
+/**
+ * @brief Read a physical netlist that is already in memory. The message is copied, so the caller may release it afterwards.
+ *
+ */
+void Netlist::read(PhysicalNetlist::PhysNetlist::Reader netlist_reader, string netlist_name)
+{
+    log() << "reading physical netlist " << netlist_name << " from memory..." << std::endl;
+    log() << std::endl;
+	netlist_builder.setRoot(netlist_reader);
+	netlist_filename = netlist_name;
+	parsePhysNetlist(netlist_builder.getRoot<PhysicalNetlist::PhysNetlist>().asReader());
+	updateNetAndConnectionBBox();
+	printStatistic();
+}
 
+void Netlist::printStatistic()
+{
     log(1) << "nets           : " << netNum << std::endl;
     log(1) << "multi-src nets : " << multi_src_net_num << std::endl;
     log(1) << "connections    : " << indirect_conn_num + direct_conn_num << std::endl;
     log(1) << "indirect connections: " << indirect_conn_num << std::endl;
     log(1) << "direct connections  : " << direct_conn_num << std::endl;
+    if (lutPinSwapping)
+        log(1) << "swappable LUT input connections: " << swappable_conn_num << std::endl;
     log(1) << std::endl;
 }
 
@@ -140,11 +164,100 @@ vector<obj_idx> Netlist::project_input_node_to_int_node(obj_idx sink_node_idx)
     return path;
 };
 
+namespace {
+
+// an input of a SLICE LUT: A1-A6 ... H1-H6
+bool isLutInputPin(const string& pin_name)
+{
+    return pin_name.size() == 2 && pin_name[0] >= 'A' && pin_name[0] <= 'H' && pin_name[1] >= '1' && pin_name[1] <= '6';
+}
+
+// A6LUT, A5LUT, ... H5LUT
+bool isLutBel(const string& bel_name)
+{
+    return bel_name.size() == 5 && bel_name[0] >= 'A' && bel_name[0] <= 'H' && (bel_name[1] == '6' || bel_name[1] == '5') && bel_name.compare(2, 3, "LUT") == 0;
+}
+
+}
+
+/**
+ * @brief Record which LUTs hold only LUT cells and which of their inputs are taken, for addEquivalentSinks().
+ * An input is taken if a cell pin is mapped to it or if any net, static nets included, routes to it.
+ *
+ */
+void Netlist::collectUsedLutPins(PhysicalNetlist::PhysNetlist::Reader netlist_reader)
+{
+    auto str_list = netlist_reader.getStrList();
+    auto markBel = [this](const string& site_name, const string& bel_name, bool is_lut_cell) {
+        auto it = lutHoldsLutCells.emplace(site_name + "/" + bel_name[0], true).first;
+        it->second = it->second && is_lut_cell;
+    };
+    for (auto placement : netlist_reader.getPlacements()) {
+        string site_name = str_list[placement.getSite()].cStr();
+        string type = str_list[placement.getType()].cStr();
+        bool is_lut_cell = type.size() == 4 && type.compare(0, 3, "LUT") == 0 && type[3] >= '1' && type[3] <= '6';
+        string bel_name = str_list[placement.getBel()].cStr();
+        if (isLutBel(bel_name)) markBel(site_name, bel_name, is_lut_cell);
+        for (auto other_bel : placement.getOtherBels()) {
+            string other_bel_name = str_list[other_bel].cStr();
+            if (isLutBel(other_bel_name)) markBel(site_name, other_bel_name, false); // e.g. LUTRAM spanning several LUTs
+        }
+        for (auto pin_map : placement.getPinMap()) {
+            if (!isLutBel(str_list[pin_map.getBel()].cStr())) continue;
+            string bel_pin = str_list[pin_map.getBelPin()].cStr();
+            if (isLutInputPin(bel_pin)) mappedLutPins.insert(site_name + "/" + bel_pin);
+        }
+    }
+
+    vector<std::pair<str_idx, str_idx>> site_pins;
+    for (auto phys_net : netlist_reader.getPhysNets()) {
+        site_pins.clear();
+        extract_site_pins(site_pins, phys_net.getSources());
+        extract_site_pins(site_pins, phys_net.getStubs());
+        for (auto& site_pin : site_pins) {
+            string pin_name = str_list[site_pin.second].cStr();
+            if (isLutInputPin(pin_name)) usedLutPins.insert(string(str_list[site_pin.first].cStr()) + "/" + pin_name);
+        }
+    }
+}
+
+/**
+ * @brief Give a connection to a LUT input the free inputs of the same LUT as alternative sinks (--lut_pin_swapping).
+ * LUT inputs are logically equivalent up to the cell pin mapping. Only inputs 1-5 are swapped: input 6 also selects
+ * between the two outputs of a fractured LUT. LUTRAMs, SRLs and route-thrus keep their pins.
+ *
+ */
+void Netlist::addEquivalentSinks(Connection& connection, const string& site_name, const string& pin_name)
+{
+    if (!isLutInputPin(pin_name) || pin_name[1] == '6' || site_name.compare(0, 5, "SLICE") != 0) return;
+    auto lut = lutHoldsLutCells.find(site_name + "/" + pin_name[0]);
+    if (lut == lutHoldsLutCells.end() || !lut->second || mappedLutPins.count(site_name + "/" + pin_name) == 0) return;
+
+    RouteNode* placed_sink = connection.getSinkRNode();
+    connection.addEquivalentSinkRNode(placed_sink);
+    for (char index = '1'; index <= '5'; index ++) {
+        string alt_pin_name = {pin_name[0], index};
+        string alt_key = site_name + "/" + alt_pin_name;
+        if (alt_pin_name == pin_name || mappedLutPins.count(alt_key) || usedLutPins.count(alt_key)) continue;
+        obj_idx alt_node_idx = device.get_site_pin_node(site_name, alt_pin_name);
+        // like the placed sink, the pin must be its own int node
+        if (alt_node_idx == invalid_obj_idx || device.nodeInfos[alt_node_idx].tileType != INT || preservedNodes[alt_node_idx]) continue;
+        routingGraph.routeNodes[alt_node_idx].setNodeType(PINFEED_I);
+        connection.addEquivalentSinkRNode(&routingGraph.routeNodes[alt_node_idx]);
+        lutPinNames[alt_node_idx] = alt_pin_name;
+    }
+    if (connection.getEquivalentSinkRNodes().size() == 1)
+        connection.clearEquivalentSinkRNodes();
+    else
+        swappable_conn_num ++;
+}
+
 void Netlist::parseNetlist(string netlist_file)
 {
     // Start reading the raw netlist file
     gzFile file = gzopen(netlist_file.c_str(), "r");
-    assert(file != Z_NULL);
+    if (file == Z_NULL)
+        throw std::runtime_error("cannot open netlist " + netlist_file);
 
     vector<uint8_t> buf_data(4096);
     std::stringstream sstream(std::ios_base::in | std::ios_base::out | std::ios_base::binary);
@@ -180,22 +293,27 @@ void Netlist::parseNetlist(string netlist_file)
     kj::std::StdInputStream istream2(sstreamOut);
 	capnp::readMessageCopy(istream2, netlist_builder, reader_options);
 
-    auto netlist_reader = message_reader.getRoot<PhysicalNetlist::PhysNetlist>();
+    std::filesystem::path netlist_filepath = netlist_file;
+    netlist_filename = netlist_filepath.filename();
+    parsePhysNetlist(message_reader.getRoot<PhysicalNetlist::PhysNetlist>());
+}
+
+void Netlist::parsePhysNetlist(PhysicalNetlist::PhysNetlist::Reader netlist_reader)
+{
     str_list = netlist_reader.getStrList();
     phys_nets = netlist_reader.getPhysNets();
 
     log(1) << "str_list       : " << str_list.size() << std::endl;
     log(1) << "phys_nets      : " << phys_nets.size() << std::endl;
 
-    std::filesystem::path netlist_filepath = netlist_file;
-    netlist_filename = netlist_filepath.filename();
-
     connNum = 0;
     netNum = 0;
 	directConnections.reserve(phys_nets.size());
 	indirectConnections.reserve(phys_nets.size() * 100);
     preservedNodes.resize(device.nodeNum, false);
     nets.reserve(phys_nets.size());
+    if (lutPinSwapping)
+        collectUsedLutPins(netlist_reader);
     for (obj_idx net_idx = 0; net_idx < phys_nets.size(); net_idx++) {
         const auto& phys_net = phys_nets[net_idx];
         const auto& stub_nodes = phys_net.getStubNodes();
@@ -257,10 +375,8 @@ void Netlist::parseNetlist(string netlist_file)
             }
 
             // debug ->
-            if (src_node_idx_cands.size() > 2) {
-                log(LOG_ERROR) << "src_node_idx_cands.size() " << src_node_idx_cands.size() << endl;
-                exit(1);
-            }
+            if (src_node_idx_cands.size() > 2)
+                throw std::runtime_error("net " + std::to_string(net_idx) + " has " + std::to_string(src_node_idx_cands.size()) + " source pins");
             // debug <-
 
             src_node_idx = src_node_idx_cands[0];
@@ -290,10 +406,8 @@ void Netlist::parseNetlist(string netlist_file)
                         real_src_node_idx = src_int_node_idx;
 						real_src_path = src_path;
                     } else {
-                        if (alt_src_int_node_idx  == invalid_obj_idx) {
-                            log(LOG_ERROR) << "invalid src_int_node_idx and alt_src_int_node_idx for indirect conn" << endl;
-                            exit(1);
-                        }
+                        if (alt_src_int_node_idx  == invalid_obj_idx)
+                            throw std::runtime_error("invalid src_int_node_idx and alt_src_int_node_idx for indirect conn of net " + std::to_string(net_idx));
                         real_src_node_idx = alt_src_int_node_idx;
 						real_src_path = alt_src_path;
                     }
@@ -310,6 +424,8 @@ void Netlist::parseNetlist(string netlist_file)
 
 					indirectConnections.back().setSourceRNode(&routingGraph.routeNodes[real_src_node_idx]); // TODO: hide this or replace 
 					indirectConnections.back().setSinkRNode(&routingGraph.routeNodes[real_sink_node_idx]);
+					if (lutPinSwapping && path.size() == 1)
+						addEquivalentSinks(indirectConnections.back(), site_name, pin_name);
 					nets[netNum].addConns(indirect_conn_num);
 					nets[netNum].setIndirectSourceRNode(&routingGraph.routeNodes[real_src_node_idx]);
 					nets[netNum].addIndirectSinkRNode(&routingGraph.routeNodes[real_sink_node_idx]);
@@ -484,9 +600,49 @@ void Netlist::updateNetAndConnectionBBox()
 	}
 }
 
-void Netlist::write(string netlist_file, const vector<RouteResult>& nodeRoutingResults) 
+bool Netlist::write(string netlist_file, const vector<RouteResult>& nodeRoutingResults) 
 {
 	utils::timer timer; timer.start();
+	bool isComplete = dumpRoutingSolution(nodeRoutingResults);
+	auto cld= [this] (int tid) {
+		for (int i = tid; i < 8; i += numThread) {
+			if (i == 0) clearData();
+			else if (releaseDeviceAfterWrite) device.clearData(i - 1);
+		}
+	};
+	vector<std::thread> jobs;
+	for (int tid = 0; tid < numThread; tid ++) jobs.emplace_back(cld, tid);
+	try {
+		writeToFile(netlist_file);
+	} catch (...) {
+		for (auto& job : jobs) job.join();
+		throw;
+	}
+	std::cout << "Write time: " << std::fixed << std::setprecision(2) << timer.elapsed() << std::endl;
+	for (int i = 0; i < jobs.size(); i ++)
+		jobs[i].join();
+	return isComplete;
+}
+
+/**
+ * @brief Dump the routing solution and copy the routed netlist into message instead of a file. The device data is kept.
+ *
+ */
+bool Netlist::write(capnp::MessageBuilder& message, const vector<RouteResult>& nodeRoutingResults)
+{
+	bool isComplete = dumpRoutingSolution(nodeRoutingResults);
+	message.setRoot(netlist_builder.getRoot<PhysicalNetlist::PhysNetlist>().asReader());
+	clearData();
+	return isComplete;
+}
+
+/**
+ * @brief Turn the routing result into the route branches of the physical nets.
+ *
+ * @return false if some sink pins are not routed; they are kept as stubs of their nets
+ */
+bool Netlist::dumpRoutingSolution(const vector<RouteResult>& nodeRoutingResults)
+{
 	log() << "Dump routing solution into netlist_builder [Start]" << std::endl;
 	auto netlist = netlist_builder.getRoot<PhysicalNetlist::PhysNetlist>();
 	auto str_list = netlist.getStrList();
@@ -508,6 +664,15 @@ void Netlist::write(string netlist_file, const vector<RouteResult>& nodeRoutingR
 		}
 		return new_str_id_map[id];
 	};
+	auto getPinNameIndex = [&old_str_len, &new_str_list, &string2StrIdx](const string& name) {
+		auto it = string2StrIdx.find(name);
+		if (it != string2StrIdx.end()) return it->second;
+		new_str_list.emplace_back(name);
+		str_idx id = old_str_len + new_str_list.size() - 1;
+		string2StrIdx[name] = id;
+		return id;
+	};
+	std::map<std::pair<str_idx, str_idx>, str_idx> swappedPins; // (site, placed pin) -> swapped pin
 
 	int numPIPs = 0;
 	int numNetFail = 0;
@@ -531,18 +696,30 @@ void Netlist::write(string netlist_file, const vector<RouteResult>& nodeRoutingR
             if (rs.which() != PhysicalNetlist::PhysNetlist::RouteBranch::RouteSegment::Which::SITE_PIN) continue;
 			auto sp = rs.getSitePin();
    			obj_idx nodeId = device.get_site_pin_node(str_list[sp.getSite()].cStr(), str_list[sp.getPin()].cStr());
-			if (routingGraph.routeNodes[nodeId].getNodeType() != PINFEED_I) {
-				std::cout << routingGraph.routeNodes[nodeId].getNodeType() << " " << PINFEED_I << std::endl;
-				exit(0);
-			}
+			if (routingGraph.routeNodes[nodeId].getNodeType() != PINFEED_I)
+				throw std::runtime_error("the sink pin node " + std::to_string(nodeId) + " of net " + std::to_string(ni) + " is not a PINFEED_I");
 			// sinkPin2orphan[nodeId] = stubs[i].disownBranches();
 			sinkPinStub[nodeId] = i;
 		}
+		// a swapped sink takes the stub of its placed pin, renamed
+		std::unordered_map<int, str_idx> stubNewPin;
+		for (int connId : nets[ni].getConnectionsByRef()) {
+			const Connection& conn = indirectConnections[connId];
+			if (conn.getSink() == conn.getPlacedSink()) continue;
+			int stubId = sinkPinStub.at(conn.getPlacedSink());
+			sinkPinStub.erase(conn.getPlacedSink());
+			sinkPinStub[conn.getSink()] = stubId;
+			auto sp = stubs[stubId].getRouteSegment().getSitePin();
+			str_idx newPin = getPinNameIndex(lutPinNames.at(conn.getSink()));
+			stubNewPin[stubId] = newPin;
+			swappedPins[{sp.getSite(), sp.getPin()}] = newPin;
+		}
 		// phys_net.disownStubs();
 
 		// Walk through all net sources until a source site pin is found
 		std::queue<PhysicalNetlist::PhysNetlist::RouteBranch::Builder> sourceQueue;
 		for (auto s : phys_net.getSources()) sourceQueue.push(s);
+		vector<bool> routedStubs(stubs.size(), false);
 		int routedPinNum = 0;
 		while (!sourceQueue.empty()) {
 			auto rb = sourceQueue.front(); sourceQueue.pop();
@@ -583,8 +760,12 @@ void Netlist::write(string netlist_file, const vector<RouteResult>& nodeRoutingR
 					// branches[branches.size() - 1].adoptBranches(kj::mv(orphan)); // TODO: verify
 					auto b = branches[branches.size() - 1];
 					copyBranch(stubs[sinkPinStub[nodeId]], b);
+					auto newPin = stubNewPin.find(sinkPinStub[nodeId]);
+					if (newPin != stubNewPin.end())
+						renameSitePin(b, b.getRouteSegment().getSitePin().getPin(), newPin->second);
 					// b.adoptBranches(kj::mv(orphan));
 					// sinkPin2orphan.erase(nodeId);
+					routedStubs[sinkPinStub[nodeId]] = true;
 					routedPinNum ++;
 				} else {
 					// Not a site pin, must have nextNodes
@@ -608,19 +789,29 @@ void Netlist::write(string netlist_file, const vector<RouteResult>& nodeRoutingR
 			}
 		}
 		if (routedPinNum != stubs.size()) {
+			// the unrouted pins stay as stubs of the net
 			numNetFail ++;
-			log(LOG_ERROR) << "There are unrouted pins " << stubs.size() << " vs " << routedPinNum << std::endl;
-			std::cout << nets[ni].getConnectionSize() << " " << nets[ni].getDirectConnectionSize() << std::endl;
-			for (auto rnode : nets[ni].getIndirectSinkPinRNodes()) {
-				std::cout << nodeRoutingResults[rnode->getId()].netId << " " << ni << " | " << (rnode->getNodeType() == PINFEED_I) << std::endl;
-			}
-			for (auto rnode : nets[ni].getDirectSinkPinRNodes()) {
-				std::cout << nodeRoutingResults[rnode->getId()].netId << " " << ni << " | " << (rnode->getNodeType() == PINFEED_I) << std::endl;
-			}
-			exit(0);
+			auto oldStubs = phys_net.disownStubs();
+			auto unroutedStubs = phys_net.initStubs(std::count(routedStubs.begin(), routedStubs.end(), false));
+			for (int i = 0, j = 0; i < routedStubs.size(); i ++)
+				if (!routedStubs[i]) copyBranch(oldStubs.get()[i], unroutedStubs[j ++]);
+		} else {
+			phys_net.disownStubs();
 		}
-		phys_net.disownStubs();
     }
+	// the cell pins mapped to a swapped LUT input follow it
+	if (!swappedPins.empty()) {
+		for (auto placement : netlist.getPlacements()) {
+			str_idx site = placement.getSite();
+			for (auto pinMap : placement.getPinMap()) {
+				if (!isLutBel(str_list[pinMap.getBel()].cStr())) continue;
+				auto it = swappedPins.find({site, pinMap.getBelPin()});
+				if (it != swappedPins.end())
+					pinMap.setBelPin(it->second);
+			}
+		}
+		log() << "Swapped LUT pins: " << swappedPins.size() << std::endl;
+	}
 	// Initialize a new strList entry (capnp does not support resizing an existing list).
     // Rather than copying the underlying string text, detach the pointer
     //  ("disown") them from the existing list and reference ("adopt") them in the new list.
@@ -640,22 +831,11 @@ void Netlist::write(string netlist_file, const vector<RouteResult>& nodeRoutingR
 	log() << "NewStrNum: " << new_str_list.size() << std::endl;
 
 	if (numNetFail != 0) {
-		log() << numNetFail << " / " << netNum << " nets have unrouted pins" << std::endl;
-		exit(0);
+		log(LOG_ERROR) << numNetFail << " / " << netNum << " nets have unrouted pins, left as stubs" << std::endl;
+		return false;
 	}
-	auto cld= [this] (int tid) {
-		for (int i = tid; i < 8; i += numThread) {
-			if (i == 0) clearData();
-			else device.clearData(i - 1);
-		}
-	};
-	vector<std::thread> jobs;
 	log() << "Dump routing solution into netlist_builder [Finish]" << std::endl;
-	for (int tid = 0; tid < numThread; tid ++) jobs.emplace_back(cld, tid);
-	writeToFile(netlist_file);
-	std::cout << "Write time: " << std::fixed << std::setprecision(2) << timer.elapsed() << std::endl;
-	for (int i = 0; i < jobs.size(); i ++)
-		jobs[i].join();
+	return true;
 }
 
 void Netlist::copyBranch(PhysicalNetlist::PhysNetlist::RouteBranch::Builder src, PhysicalNetlist::PhysNetlist::RouteBranch::Builder tgt)
@@ -701,11 +881,35 @@ void Netlist::copyBranch(PhysicalNetlist::PhysNetlist::RouteBranch::Builder src,
 	}
 }
 
+/**
+ * @brief Rename a site pin of a sink stub and the LUT bel pins behind it (--lut_pin_swapping).
+ * The site port bel of a SLICE input has the name of its pin.
+ *
+ */
+void Netlist::renameSitePin(PhysicalNetlist::PhysNetlist::RouteBranch::Builder branch, str_idx old_pin, str_idx new_pin)
+{
+	auto rs = branch.getRouteSegment();
+	if (rs.which() == PhysicalNetlist::PhysNetlist::RouteBranch::RouteSegment::Which::SITE_PIN) {
+		auto sp = rs.getSitePin();
+		if (sp.getPin() == old_pin) sp.setPin(new_pin);
+	} else if (rs.which() == PhysicalNetlist::PhysNetlist::RouteBranch::RouteSegment::Which::BEL_PIN) {
+		auto bp = rs.getBelPin();
+		if (bp.getBel() == old_pin) bp.setBel(new_pin);
+		if (bp.getPin() == old_pin) bp.setPin(new_pin);
+	} else if (rs.which() == PhysicalNetlist::PhysNetlist::RouteBranch::RouteSegment::Which::SITE_P_I_P) {
+		auto sp = rs.getSitePIP();
+		if (sp.getPin() == old_pin) sp.setPin(new_pin);
+	}
+	for (auto child : branch.getBranches())
+		renameSitePin(child, old_pin, new_pin);
+}
+
 void Netlist::writeToFile(string netlist_file) {
 	log() << "Write to file " << netlist_file << " [Start]" << std::endl;
 	// Compress GZipped capnproto physical netlist file
     gzFile file = gzopen(netlist_file.c_str(), "w");
-    assert(file != Z_NULL);
+    if (file == Z_NULL)
+        throw std::runtime_error("cannot write netlist " + netlist_file);
 
     std::stringstream sstream(std::ios_base::in | std::ios_base::out | std::ios_base::binary);
 	kj::std::StdOutputStream ostream(sstream);
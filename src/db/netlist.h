@@ -11,6 +11,7 @@
 #include "db/routeNode.h"
 #include "routeResult.h"
 #include <filesystem>
+#include <unordered_set>
 
 namespace Raw {
 class Netlist {
@@ -26,12 +27,16 @@ public:
 		{};
     ~Netlist();
     void read(string netlist_file);
-    void write(string netlist_file, const vector<RouteResult>& nodeRoutingResults);
+    void read(PhysicalNetlist::PhysNetlist::Reader netlist_reader, string netlist_name);
+    bool write(string netlist_file, const vector<RouteResult>& nodeRoutingResults); // false if some pins are not routed
+    bool write(capnp::MessageBuilder& message, const vector<RouteResult>& nodeRoutingResults);
     void writeToFile(string netlist_file);
 
     int connNum;
 	int netNum;
 	int numThread = 16;
+	bool releaseDeviceAfterWrite = true; // false if the device is shared with other designs
+	bool lutPinSwapping = false; // collect the equivalent pins of LUT input sinks while reading (--lut_pin_swapping)
 
 	vector<bool>& preservedNodes;
 	utils::BoxT<int> layout;
@@ -50,10 +55,16 @@ private:
 	void updateNetAndConnectionBBox();
 	void loadFile(string netlist_file);
 	void parseNetlist(string netlist_file);
+	void parsePhysNetlist(PhysicalNetlist::PhysNetlist::Reader netlist_reader);
+	bool dumpRoutingSolution(const vector<RouteResult>& nodeRoutingResults);
+	void printStatistic();
 	void extract_site_pins(std::vector<std::pair<str_idx, str_idx>>& site_pins, capnp::List<PhysicalNetlist::PhysNetlist::RouteBranch>::Reader branches);
     void extract_site_pins_one_by_one(std::vector<std::pair<str_idx, str_idx>>& site_pins, capnp::List<PhysicalNetlist::PhysNetlist::RouteBranch>::Reader branches);
 	vector<obj_idx> project_input_node_to_int_node(obj_idx sink_node_idx);
 	obj_idx project_output_node_to_int_node(obj_idx src_node_idx, vector<obj_idx>& path);
+	void collectUsedLutPins(PhysicalNetlist::PhysNetlist::Reader netlist_reader);
+	void addEquivalentSinks(Connection& connection, const string& site_name, const string& pin_name);
+	void renameSitePin(PhysicalNetlist::PhysNetlist::RouteBranch::Builder branch, str_idx old_pin, str_idx new_pin);
     int min3(int n1, int n2, int n3) {
         int min = n1;
         min = (n2 < min ? n2 : min);
@@ -82,6 +93,14 @@ private:
     int indirect_conn_num = 0;
     int direct_conn_num = 0;
 
+    // LUT pin swapping ->
+    unordered_map<string, bool> lutHoldsLutCells;  // "<site>/<letter>": the LUT bels hold only LUT1-LUT6 cells
+    std::unordered_set<string> mappedLutPins;     // "<site>/<pin>": LUT inputs mapped to a cell pin
+    std::unordered_set<string> usedLutPins;       // "<site>/<pin>": LUT inputs on the route of any net
+    unordered_map<obj_idx, string> lutPinNames;   // pin name of each swap target
+    int swappable_conn_num = 0;
+    // LUT pin swapping <-
+
 
 	::capnp::List< ::capnp::Text,  ::capnp::Kind::BLOB>::Reader str_list;
 	::capnp::List< ::PhysicalNetlist::PhysNetlist::PhysNet,  ::capnp::Kind::STRUCT>::Reader phys_nets;
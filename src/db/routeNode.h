@@ -19,7 +19,8 @@ public:
 		baseCost(baseCost_),
 		length(length_),
 		type(type_),
-		isNodePinBounce(isNodePinBounce_){
+		isNodePinBounce(isNodePinBounce_),
+		congestionCost(baseCost_){
 		children.reserve(8);  // Reserve capacity to reduce dynamic reallocations
 	}
 	RouteNode() :
@@ -37,7 +38,8 @@ public:
 		children(),
 		occupancy(0),
 		presentCongestionCost(1.0f),
-		historicalCongestionCost(1.0f) {
+		historicalCongestionCost(1.0f),
+		congestionCost(0.0f) {
 		children.reserve(8);  // Reserve capacity to reduce dynamic reallocations
 	}
 	RouteNode(const RouteNode& that) :
@@ -55,7 +57,8 @@ public:
 		children(that.children),
 		occupancy(that.occupancy.load()),
 		presentCongestionCost(that.presentCongestionCost),
-		historicalCongestionCost(that.historicalCongestionCost) {}
+		historicalCongestionCost(that.historicalCongestionCost),
+		congestionCost(that.congestionCost) {}
 	obj_idx getId() const {return id;}
 	short getCapacity() const {return NODE_CAPACITY;}
 	short getEndTileXCoordinate() const {return endTileXCoordinate;}
@@ -74,6 +77,8 @@ public:
 
 	float getPresentCongestionCost() const {return presentCongestionCost;}
 	float getHistoricalCongestionCost() const {return historicalCongestionCost;}
+	// baseCost * historicalCongestionCost * presentCongestionCost, kept current by the setters for the A* cost of a node
+	float getCongestionCost() const {return congestionCost;}
 
 	void setId(obj_idx v) {id = v;}
 	void setEndTileXCoordinate(short v) {endTileXCoordinate = v;}
@@ -82,7 +87,7 @@ public:
 	void setBeginTileYCoordinate(short v) {beginTileYCoordinate = v;}
 	void setLength(short v) {length = v;}
 	void setIsAccesibleWire(bool v) {isAccessibleWire = v;}
-	void setBaseCost(float v) {baseCost = v;}
+	void setBaseCost(float v) {baseCost = v; updateCongestionCost();}
 	void setIsNodePinBounce(bool v) {isNodePinBounce = v;}
 
 	void setChildren(std::vector<RouteNode*> cs) {children = cs;}
@@ -90,7 +95,7 @@ public:
 	void addChildren(RouteNode* c) {children.emplace_back(c);}
 	void setNodeType(NodeType t) {type = t;}
 
-	void setPresentCongestionCost(float cost) {presentCongestionCost = cost;}
+	void setPresentCongestionCost(float cost) {presentCongestionCost = cost; updateCongestionCost();}
 	void updatePresentCongestionCost(float pres_fac) {
         int occ = getOccupancy();
         if (occ < NODE_CAPACITY)
@@ -98,7 +103,7 @@ public:
         else 
             setPresentCongestionCost(1 + (occ - NODE_CAPACITY + 1) * pres_fac);
     }
-	void setHistoricalCongestionCost(float cost) {historicalCongestionCost = cost;}
+	void setHistoricalCongestionCost(float cost) {historicalCongestionCost = cost; updateCongestionCost();}
 
 	// methods for usersConnectionCounts
 	// int getOccupancy() const {return occupancy;}
@@ -108,6 +113,7 @@ public:
 
 	void incrementOccupancy() {occupancy ++;} 
 	void decrementOccupancy() {occupancy --;}
+	void setOccupancy(int occ) {occupancy = occ;}
 
 	void setNeedUpdateBatchStamp(int batchStamp) {needUpdateBatchStamp = batchStamp;}
 	int getNeedUpdateBatchStamp() const {return needUpdateBatchStamp;}
@@ -134,6 +140,9 @@ private:
 	
 	float presentCongestionCost = 1;
 	float historicalCongestionCost = 1;
+	float congestionCost = 0; // cached product, fits in the padding after historicalCongestionCost
+
+	void updateCongestionCost() {congestionCost = baseCost * historicalCongestionCost * presentCongestionCost;}
 
 	friend class boost::serialization::access;
 	template<class Archive>
@@ -150,6 +159,7 @@ private:
 		ar & baseCost;
 		ar & type;
 		ar & isNodePinBounce;
+		updateCongestionCost(); // not stored, derived from the loaded baseCost
 
 		// ar & upStreamPathCost;
 		// ar & lowerBoundTotalPathCost;
@@ -166,18 +176,24 @@ public:
     int isVisited;           // 4 bytes - Visited flag
     int isTarget;            // 4 bytes - Target flag
 
+    // Backward labels of bidirectional search, the counterparts of prev, partialCost and isVisited
+    RouteNode* next;         // 8 bytes - The next node towards the sink
+    double backwardCost;     // 8 bytes - Cost of this node and the path after it to the sink
+    int isVisitedBackward;   // 4 bytes - Visited flag of the backward search
+
 private:
     // Cold data (less frequently accessed)
     int occChange;           // 4 bytes
     int occChangeBatchStamp; // 4 bytes - iter * numBatches + batchId
 
     // Padding to exactly 64 bytes (one cacheline)
-    // Current: 8+8+8+4+4+4+4 = 40 bytes
-    // Padding: 64-40 = 24 bytes
-    char padding[24];
+    // Current: 8+8+8+4+4+8+8+4+4+4 = 60 bytes
+    // Padding: 64-60 = 4 bytes
+    char padding[4];
 
 public:
-	NodeInfo(): prev(nullptr), cost(0), partialCost(0), isVisited(-1), isTarget(-1), occChange(0), occChangeBatchStamp(-1) {}
+	NodeInfo(): prev(nullptr), cost(0), partialCost(0), isVisited(-1), isTarget(-1),
+		next(nullptr), backwardCost(0), isVisitedBackward(-1), occChange(0), occChangeBatchStamp(-1) {}
 
 	void erase() {
 		prev = nullptr; cost = 0; partialCost = 0; isVisited = -1; isTarget = -1;
@@ -187,6 +203,10 @@ public:
 		prev = prev_; cost = cost_; partialCost = partialCost_; isVisited = isVisited_; isTarget = isTarget_;
 	}
 
+	void writeBackward(RouteNode* next_, double backwardCost_, int isVisitedBackward_) {
+		next = next_; backwardCost = backwardCost_; isVisitedBackward = isVisitedBackward_;
+	}
+
 	void write(NodeInfo* ninfo) { write(ninfo->prev, ninfo->cost, ninfo->partialCost, ninfo->isVisited, ninfo->isTarget); }
 
 	void write(NodeInfo& ninfo) { write(ninfo.prev, ninfo.cost, ninfo.partialCost, ninfo.isVisited, ninfo.isTarget); }
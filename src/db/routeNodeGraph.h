@@ -2,6 +2,7 @@
 #include "global.h"
 #include "routeNode.h"
 #include "connection.h"
+#include "utils/hugePage.h"
 #include <set>
 
 
@@ -9,6 +10,6 @@ class RouteNodeGraph
 {
 public:
 	RouteNodeGraph(){};
-	vector<RouteNode> routeNodes;
+	utils::huge_vector<RouteNode> routeNodes; // huge pages: randomly accessed by every search
 	bool isAccessible(const RouteNode* childRnode, const Connection& connection);
 };
@@ -12,6 +12,7 @@
 #include "global.h"
 #include "db/database.h"
 #include "route/aStarRoute.h"
+#include "rpc/routeService.h"
 
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/archive/binary_iarchive.hpp>
@@ -29,7 +30,34 @@ int main(int argc, char **argv) {
 		("o,output", "[REQUIRED] The output (routed) physical netlist", cxxopts::value<std::string>())
 		("d,device", "The device file", cxxopts::value<std::string>()->default_value("xcvu3p.device"))
 		("t,thread", "The number of threads", cxxopts::value<int>()->default_value("32"))
-		("r,runtime_first", "Enable runtime first mode", cxxopts::value<bool>()->implicit_value("true")->default_value("false"));
+		("huge_pages", "Back the routing graph and search arrays with huge pages: off, thp, 2m or 1g (explicit pages, falling back to thp)", cxxopts::value<std::string>()->default_value("thp"))
+		("device_image", "Share the node/wire tables of the device (not the route nodes) through this memory-mapped file (e.g. under /dev/shm); the first process builds it", cxxopts::value<std::string>()->default_value(""))
+		("r,runtime_first", "Enable runtime first mode", cxxopts::value<bool>()->implicit_value("true")->default_value("false"))
+		("checkpoint", "Periodically save the routing state to this file", cxxopts::value<std::string>()->default_value(""))
+		("checkpoint_interval", "The number of routing iterations between two checkpoints", cxxopts::value<int>()->default_value("5"))
+		("resume", "Resume routing from the checkpoint file", cxxopts::value<bool>()->implicit_value("true")->default_value("false"))
+		("adaptive_bbox", "Start with tight per-connection bounding boxes that grow on failure or persistent congestion", cxxopts::value<bool>()->implicit_value("true")->default_value("false"))
+		("multi_source", "Route later connections of a net from all nodes of the net's routed tree", cxxopts::value<bool>()->implicit_value("true")->default_value("false"))
+		("heuristic_weight_start", "Inflated A* heuristic weight of the first iterations, relaxed to the default as the overuse drops (0: fixed weight)", cxxopts::value<double>()->default_value("0"))
+		("adaptive_heuristic", "Raise the heuristic weight of connections whose last search explored many nodes", cxxopts::value<bool>()->implicit_value("true")->default_value("false"))
+		("partial_ripup", "Reroute only the congested part of a routed connection, falling back to a full reroute", cxxopts::value<bool>()->implicit_value("true")->default_value("false"))
+		("lut_pin_swapping", "Let a connection to a LUT input end at any free input of the same LUT and update the cell pin mapping accordingly", cxxopts::value<bool>()->implicit_value("true")->default_value("false"))
+		("net_tree_fanout", "Route nets with at least this many connections as trees: sinks in Prim order from the source, each grown from the tree, the whole net rebuilt when rerouted (0: disabled)", cxxopts::value<int>()->default_value("0"))
+		("cost_bound", "Bound the reroute of a routed connection by the cost of its old path, and keep the old path if nothing cheaper is found", cxxopts::value<bool>()->implicit_value("true")->default_value("false"))
+		("cost_bound_slack", "Relative slack added to the old path cost of --cost_bound", cxxopts::value<double>()->default_value("0.1"))
+		("bidirectional_hpwl", "Search connections with at least this HPWL (in tiles) from both the source and the sink (0: disabled)", cxxopts::value<int>()->default_value("0"))
+		("prefetch_distance", "The number of children prefetched ahead in A* expansions (0: no software prefetch)", cxxopts::value<int>()->default_value("4"))
+		("batch_expansion", "Evaluate the children of A* expansions in SIMD batches", cxxopts::value<bool>()->implicit_value("true")->default_value("true"))
+		("sparse_iterations", "The number of first iterations that search a sparse graph of the cheapest wires per direction and length, then the full graph on failure (0: disabled)", cxxopts::value<int>()->default_value("0"))
+		("corridor_iterations", "Route all connections on a coarse grid of tiles first, and keep the searches of this many first iterations in the corridor of their coarse path, then the full graph on failure (0: disabled)", cxxopts::value<int>()->default_value("0"))
+		("gcell_size", "Width in tiles of the coarse grid cells of --corridor_iterations", cxxopts::value<int>()->default_value("4"))
+		("reach_cone_mb", "Memory cap in MB of the cached sink reachability cones that prune A* for connections with many expansions (0: disabled)", cxxopts::value<int>()->default_value("0"))
+		("trace_search", "Log the number of A* expansions of every routing iteration", cxxopts::value<bool>()->implicit_value("true")->default_value("false"))
+		("time_budget", "Wall-clock budget of the routing stage in seconds; without a legal solution in time, the best one is written and the exit status is 2 (0: unlimited)", cxxopts::value<double>()->default_value("0"))
+		("serve", "Run as a daemon: load the device once and serve route jobs on this Unix socket", cxxopts::value<std::string>())
+		("connect", "Submit the job to the daemon listening on this Unix socket", cxxopts::value<std::string>())
+		("batch", "Route all \"<input> <output>\" pairs listed in this file on one loaded device", cxxopts::value<std::string>())
+		("batch_jobs", "The number of batch jobs routed at the same time; the threads are split among them", cxxopts::value<int>()->default_value("1"));
 
 	auto result = options.parse(argc, argv);
 
@@ -38,6 +66,77 @@ int main(int argc, char **argv) {
         return 0;
     }
 
+	utils::huge_pages::mode hugePageMode;
+	if (!utils::huge_pages::parse_mode(result["huge_pages"].as<std::string>(), hugePageMode)) {
+		std::cerr << "--huge_pages must be one of off, thp, 2m, 1g" << endl;
+		return 1;
+	}
+	utils::huge_pages::set_mode(hugePageMode);
+
+	if (result.count("serve")) {
+		return serveRouteJobs(result["serve"].as<std::string>(), result["device"].as<std::string>(), result["device_image"].as<std::string>(), result["thread"].as<int>());
+	}
+
+	string deviceName = result["device"].as<std::string>();
+	int numThread = result["thread"].as<int>();
+	RouteOptions routeOptions;
+	routeOptions.isRuntimeFirst = result["runtime_first"].as<bool>();
+	routeOptions.checkpointFile = result["checkpoint"].as<std::string>();
+	routeOptions.checkpointInterval = result["checkpoint_interval"].as<int>();
+	routeOptions.resume = result["resume"].as<bool>();
+	routeOptions.timeBudget = result["time_budget"].as<double>();
+	routeOptions.traceSearch = result["trace_search"].as<bool>();
+	routeOptions.multiSource = result["multi_source"].as<bool>();
+	routeOptions.adaptiveBBox = result["adaptive_bbox"].as<bool>();
+	routeOptions.bidirectionalHpwl = result["bidirectional_hpwl"].as<int>();
+	routeOptions.partialRipup = result["partial_ripup"].as<bool>();
+	routeOptions.lutPinSwapping = result["lut_pin_swapping"].as<bool>();
+	routeOptions.netTreeFanout = result["net_tree_fanout"].as<int>();
+	routeOptions.costBound = result["cost_bound"].as<bool>();
+	routeOptions.costBoundSlack = result["cost_bound_slack"].as<double>();
+	routeOptions.prefetchDistance = result["prefetch_distance"].as<int>();
+	routeOptions.batchExpansion = result["batch_expansion"].as<bool>();
+	routeOptions.reachConeMB = result["reach_cone_mb"].as<int>();
+	routeOptions.sparseIterations = result["sparse_iterations"].as<int>();
+	routeOptions.corridorIterations = result["corridor_iterations"].as<int>();
+	routeOptions.gcellSize = result["gcell_size"].as<int>();
+	routeOptions.heuristicWeightStart = result["heuristic_weight_start"].as<double>();
+	routeOptions.adaptiveHeuristic = result["adaptive_heuristic"].as<bool>();
+	if (routeOptions.prefetchDistance < 0) {
+		std::cerr << "--prefetch_distance must not be negative" << endl;
+		return 1;
+	}
+	if (routeOptions.costBoundSlack < 0) {
+		std::cerr << "--cost_bound_slack must not be negative" << endl;
+		return 1;
+	}
+	if (routeOptions.reachConeMB < 0) {
+		std::cerr << "--reach_cone_mb must not be negative" << endl;
+		return 1;
+	}
+	if (routeOptions.gcellSize < 1) {
+		std::cerr << "--gcell_size must be positive" << endl;
+		return 1;
+	}
+	if (routeOptions.resume && routeOptions.checkpointFile.empty()) {
+		std::cerr << "--resume requires --checkpoint" << endl;
+		return 1;
+	}
+
+	if (result.count("batch")) {
+		if (!routeOptions.checkpointFile.empty()) {
+			std::cerr << "--checkpoint cannot be used with --batch" << endl;
+			return 1;
+		}
+		vector<RouteJobSpec> jobs;
+		if (!readRouteJobs(result["batch"].as<std::string>(), jobs))
+			return 1;
+		for (auto& job : jobs)
+			job.options = routeOptions;
+		potter::Device device(deviceName, result["device_image"].as<std::string>());
+		return runRouteBatch(device, jobs, numThread, result["batch_jobs"].as<int>());
+	}
+
 	if (!result.count("input") || !result.count("output")) {
 		std::cerr << "Input and output files must be specified!!!!!" << endl;
 		std::cerr << options.help() << std::endl;
@@ -46,33 +145,54 @@ int main(int argc, char **argv) {
 
 	string inputName = result["input"].as<std::string>();
 	string outputName = result["output"].as<std::string>();
-	string deviceName = result["device"].as<std::string>();
-	int numThread = result["thread"].as<int>();
-	bool isRuntimeFirst = result["runtime_first"].as<bool>();
 
 	log() << "input: " << result["input"].as<std::string>() << endl;
 	log() << "output: " << result["output"].as<std::string>() << endl;
 	log() << "device: " << result["device"].as<std::string>() << endl;
 	log() << "thread: " << result["thread"].as<int>() << endl;
 	log() << "runtime first: " << (result["runtime_first"].as<bool>() ? "true" : "false") << endl;
+	if (!routeOptions.checkpointFile.empty())
+		log() << "checkpoint: " << routeOptions.checkpointFile << " every " << routeOptions.checkpointInterval << " iterations" << (routeOptions.resume ? " (resume)" : "") << endl;
+	if (routeOptions.timeBudget > 0)
+		log() << "time budget: " << routeOptions.timeBudget << "s" << endl;
 	log() << endl;
 
+	if (result.count("connect")) {
+		RouteJobSpec job;
+		job.input = inputName;
+		job.output = outputName;
+		job.numThread = result.count("thread") ? numThread : 0; // 0: the daemon's default
+		job.options = routeOptions;
+		return submitRouteJob(result["connect"].as<std::string>(), job);
+	}
+
 	Database database;	
 	database.setNumThread(numThread);
+	database.setLutPinSwapping(routeOptions.lutPinSwapping);
+	database.context.imageFile = result["device_image"].as<std::string>();
 	database.readDevice(deviceName); // TODO: try to load pre-computed device file
 	database.readNetlist(inputName);		
 	database.setRouteNodeChildren();
 	database.printStatistic();
+	database.releaseDeviceNames();
 
 	// setting 
 	database.useRW = false;
 
 	// routing
-	aStarRoute router(database, isRuntimeFirst);
-	router.route();
+	aStarRoute router(database, routeOptions);
+	bool isLegal = router.route();
 
 	// write back
-	database.writeNetlist(outputName, router.nodeRoutingResults);
+	bool isComplete = database.writeNetlist(outputName, router.nodeRoutingResults);
 	database.device.check_memory_peak(-1);
+	if (!isComplete) {
+		log(LOG_ERROR) << outputName << " has unrouted pins." << endl;
+		return 2;
+	}
+	if (!isLegal && routeOptions.timeBudget > 0) {
+		log(LOG_ERROR) << "No legal solution within the time budget. " << outputName << " holds the best one found." << endl;
+		return 2;
+	}
 	return 0;
 }
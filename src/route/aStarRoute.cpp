@@ -6,25 +6,31 @@
 #include <chrono>
 #include <fstream>
 #include <filesystem>
+#include <limits>
+#include <tuple>
 #include "utils/MTStat.h"
 #include "db/routeResult.h"
 #include "utils/mkl_utils.h"
 
 /**
- * @brief The entrance of routing process
+ * @brief The entrance of routing process. The routing solution is saved for writing even if it is not legal.
  * 
+ * @return true if all connections are routed without overlap
  */
-void aStarRoute::route() 
+bool aStarRoute::route() 
 {
-	utils::timer baseTimer; baseTimer.start();
-	routeIndirectConnections();
-	std::cout << "Route indirect time: " << std::fixed << std::setprecision(2) << baseTimer.elapsed() << std::endl;
+	routeTimer.start();
+	bool isLegal = routeIndirectConnections();
+	std::cout << "Route indirect time: " << std::fixed << std::setprecision(2) << routeTimer.elapsed() << std::endl;
+	if (!isLegal)
+		log(LOG_ERROR) << "No legal routing solution: " << numOverUsedRNodes.load() << " overused nodes, " << failRouteNum.load() << " failed connections" << std::endl;
 	if (!database.useRW) {
 		routeDirectConnections();
 		saveAllRoutingSolutions();
-		std::cout << "Total route time: " << std::fixed << std::setprecision(2) << baseTimer.elapsed() << std::endl;
+		std::cout << "Total route time: " << std::fixed << std::setprecision(2) << routeTimer.elapsed() << std::endl;
 		// database.checkRoute();
 	}
+	return isLegal;
 }
 
 /**
@@ -32,14 +38,27 @@ void aStarRoute::route()
  * The distinction between indirect/direct connections follows RWRoute's approach.
  * Indirect connections are regular connections. Their routing path begins at the source CLB, traverses through INT tiles, and ultimately terminates at the target CLB.
  * Direct connections​ are connections that do not require nodes on INT tiles (such as carry chains). As a result, they have a much smaller routing search space and do not constitute a major part of the routing process.
+ * The loop stops at the first legal (overlap-free) iteration. The paths of the last iteration without overuse and with the fewest
+ * unrouted connections are kept, and restored if the loop ends on a worse one, at maxIter or when the time budget runs out.
+ * @return true if all indirect connections are routed without overlap
  */
-void aStarRoute::routeIndirectConnections()
+bool aStarRoute::routeIndirectConnections()
 {
 	log() << "Route indirect connections: " << database.numConns << std::endl;
+	if (options.batchExpansion)
+		log() << "Batch expansion: " << ChildBatch::capacity << " children per batch, " << ChildBatch::instructionSet() << " lanes" << std::endl;
 
 	// Pre-Process
-	updateIndirectConnectionBBox(xMargin, yMargin);
+	for (auto& conn : database.indirectConnections) {
+		if (options.adaptiveBBox)
+			conn.setMargins(adaptiveXMarginStart, adaptiveYMarginStart);
+		else
+			conn.setMargins(xMargin, yMargin);
+	}
+	updateIndirectConnectionBBox();
 	sortConnections();
+	if (options.netTreeFanout > 0)
+		buildNetTreeOrders();
 	updateSinkNodeUsage();
 
 	if (useParallel) {
@@ -47,19 +66,9 @@ void aStarRoute::routeIndirectConnections()
 		partition();
 
 		/* build RPTT for post-processing */
-		utils::BoxT<int> bbox;
-		for (auto& conn: database.indirectConnections) {
-			bbox = bbox.UnionWith(conn.getBBox());
-		}
-		log() << "Connections bbox: " << bbox << std::endl;
-		partitionTree = new PartitionTree(database.indirectConnections, sortedConnectionIds, bbox);
-		partitionTree->calculateNodeLevel();
-		scheduledLevel = partitionTree->schedule(partitionTree->getLeafNodes());
-		log() << "Schedule Level: " << scheduledLevel << std::endl;
+		buildPartitionTree();
 	}
 
-	log() << "---------------------------------------------------------------------------------------------------------------------------" << std::endl;
-	log() << std::setw(10) << "Iteration" << std::setw(15) << "PFactor" << std::setw(10) << "HFactor" << std::setw(20) << "RoutedConnections" << std::setw(15) << "OverlapNodes" << std::setw(15) << "decreaseRatio" << std::setw(13) << "shareRatio" << std::setw(15) << "numBatches" << std::setw(8) << "Times" << std::endl;
 	utils::timer timer;
 	float congestRatio = 0;
 	int decreaseOfCongestedNodes = 0;
@@ -67,9 +76,44 @@ void aStarRoute::routeIndirectConnections()
 	int lastOverusedNodeNum = 0;
 	float lastShareRatio = -10000;
 	float shareRatio = 0;
-	for (iter = 1; iter < maxIter; iter ++) {
+	int startIter = 1;
+	double avgIterTime = 0;
+	bool isOutOfTime = false;
+
+	if (options.resume && !options.checkpointFile.empty()) {
+		RouteCheckpoint checkpoint;
+		if (!checkpoint.load(options.checkpointFile)) {
+			log() << "No usable checkpoint in " << options.checkpointFile << ". Route from scratch." << std::endl;
+		} else if (restoreCheckpoint(checkpoint)) {
+			startIter = checkpoint.iter + 1;
+			congestRatio = checkpoint.congestRatio;
+			decreaseRatio = checkpoint.decreaseRatio;
+			lastOverusedNodeNum = checkpoint.lastOverusedNodeNum;
+			shareRatio = checkpoint.shareRatio;
+			lastShareRatio = checkpoint.lastShareRatio;
+			log() << "Resume from iteration " << checkpoint.iter << " of checkpoint " << options.checkpointFile << std::endl;
+		}
+	}
+
+	updateHeuristicWeight();
+	if (startIter <= options.sparseIterations)
+		buildSparseGraph();
+	if (startIter <= options.corridorIterations)
+		planCorridors();
+
+	log() << "---------------------------------------------------------------------------------------------------------------------------" << std::endl;
+	log() << std::setw(10) << "Iteration" << std::setw(15) << "PFactor" << std::setw(10) << "HFactor" << std::setw(20) << "RoutedConnections" << std::setw(15) << "OverlapNodes" << std::setw(15) << "decreaseRatio" << std::setw(13) << "shareRatio" << std::setw(15) << "numBatches" << std::setw(8) << "Times" << std::endl;
+	for (iter = startIter; iter < maxIter; iter ++) {
 		timer.start();
 		connectionIdBase += routedConnectionNum + 1;
+		if (sparsePass || corridorPass)
+			connectionIdBase += 2 * database.numConns; // past the labels of the unrestricted searches of the restricted iteration
+		sparsePass = iter <= options.sparseIterations;
+		if (!sparsePass && !sparseChildren.empty()) {
+			vector<int>().swap(sparseOffsets);
+			vector<RouteNode*>().swap(sparseChildren);
+		}
+		corridorPass = iter <= options.corridorIterations;
 		routedConnectionNum = 0;
 		failRouteNum = 0;
 		string labelRouteType = " ";
@@ -86,17 +130,27 @@ void aStarRoute::routeIndirectConnections()
 			}
 			else {
 				/* post-processing */
+				if (isPartitionTreeStale)
+					buildPartitionTree();
 				routePartitionTree(partitionTree);
 				useOverlapRouting = false;
 			}
 				
 		} else {
 			// single-threaded mode
+			vector<bool> isNetTreeRouted(options.netTreeFanout > 0 ? database.nets.size() : 0, false);
 			for (int connectionId : sortedConnectionIds) {
 				auto& connection = database.indirectConnections[connectionId];
+				int netId = connection.getNetId();
+				if (!netTreeOrders.empty() && !netTreeOrders[netId].empty()) {
+					// the whole net is routed at its first connection
+					if (!isNetTreeRouted[netId])
+						failRouteNum += routeNetTree(netId, 0);
+					isNetTreeRouted[netId] = true;
+					continue;
+				}
 				if (shouldRoute(connection)) {
-					ripup(connection, false);
-					bool success = routeOneConnection(connectionId, 0, false);
+					bool success = rerouteConnection(connectionId, 0, options.multiSource);
 					if (!success) {
 						failRouteNum ++;
 						auto& connection = database.indirectConnections[connectionId];
@@ -105,6 +159,9 @@ void aStarRoute::routeIndirectConnections()
 				}
 			}
 		}
+		if (options.lutPinSwapping)
+			applyPinSwaps();
+
 		if (iter == 1) {
 			/* determine the congested design based on the ratio of overused rnode number to the number of connections */ 
 			int overUseCnt = 0;
@@ -125,13 +182,66 @@ void aStarRoute::routeIndirectConnections()
 		lastShareRatio = shareRatio;
 		shareRatio = routedConnectionNum * 1.0 / numOverUsedRNodes.load();
 		lastOverusedNodeNum = numOverUsedRNodes.load();
+		updateHeuristicWeight();
 		log() << labelRouteType << std::setw(9) << iter << std::setw(15) << presentCongestionFactor << std::setw(10) << historicalCongestionFactor << std::setw(20) << routedConnectionNum << std::setw(15) << numOverUsedRNodes.load() << std::fixed << std::setw(15) << std::setprecision(2) << decreaseRatio << std::setw(13) << std::setprecision(2) << shareRatio << std::setw(15) << numBatches << std::setw(8) << std::setprecision(2) << timer.elapsed() << std::endl;
 
+		if (options.traceSearch)
+			logSearchTrace();
+
+		if (options.onProgress) {
+			std::stringstream ss;
+			ss << "iteration " << iter << ": " << numOverUsedRNodes.load() << " overlap nodes, " << routedConnectionNum << " routed connections, " << std::fixed << std::setprecision(2) << timer.elapsed() << "s";
+			options.onProgress(ss.str());
+		}
+
 		if (numOverUsedRNodes.load() == 0 && failRouteNum == 0)
 			break;
+		if (numOverUsedRNodes.load() == 0 && (legalFailures < 0 || failRouteNum <= legalFailures)) {
+			// no overuse, but connections that failed are left unrouted; a later iteration may route them or bring the overuse back
+			legalSolution.captureConnections(database.indirectConnections);
+			legalFailures = failRouteNum;
+		}
+
+		if (options.adaptiveBBox && updateAdaptiveMargins()) {
+			updateIndirectConnectionBBox();
+			isPartitionTreeStale = true;
+		}
+
+		if (options.timeBudget > 0) {
+			avgIterTime = avgIterTime == 0 ? timer.elapsed() : 0.5 * avgIterTime + 0.5 * timer.elapsed();
+			isOutOfTime = !updateTimeBudget(avgIterTime, numOverUsedRNodes.load(), decreaseOfCongestedNodes);
+		}
+
+		// a run stopped by the time budget always leaves a checkpoint to continue from
+		if (!options.checkpointFile.empty() && ((options.checkpointInterval > 0 && iter % options.checkpointInterval == 0) || isOutOfTime)) {
+			if (isOutOfTime)
+				waitForCheckpointWriter(); // saveCheckpoint() skips a checkpoint while the previous one is being written
+			RouteCheckpoint* checkpoint = new RouteCheckpoint();
+			checkpoint->iter = iter;
+			checkpoint->congestRatio = congestRatio;
+			checkpoint->decreaseRatio = decreaseRatio;
+			checkpoint->lastOverusedNodeNum = lastOverusedNodeNum;
+			checkpoint->shareRatio = shareRatio;
+			checkpoint->lastShareRatio = lastShareRatio;
+			saveCheckpoint(checkpoint);
+		}
+
+		if (isOutOfTime)
+			break;
 	}
+	sparsePass = false;
+	corridorPass = false;
+	waitForCheckpointWriter();
 	log() << "---------------------------------------------------------------------------------------------------------------------------" << std::endl;
 	log() << "Congest ratio: " << congestRatio << " label: " << isCongestedDesign << std::endl;
+	if (isOutOfTime)
+		log() << "Time budget of " << options.timeBudget << "s exhausted after iteration " << iter << " (" << std::setprecision(2) << routeTimer.elapsed() << "s)" << std::endl;
+	if (legalFailures >= 0 && (numOverUsedRNodes.load() > 0 || failRouteNum > legalFailures)) {
+		restorePaths(legalSolution);
+		numOverUsedRNodes.store(0);
+		failRouteNum = legalFailures;
+		log() << "Restored the last solution without overuse: " << legalFailures << " connections unrouted" << std::endl;
+	}
 
 	if (useOverlapRouting) {
 		delete partitionTree;
@@ -139,6 +249,348 @@ void aStarRoute::routeIndirectConnections()
 			delete treeForLabeledNets;
 		}
 	}
+
+	return numOverUsedRNodes.load() == 0 && failRouteNum == 0;
+}
+
+/**
+ * @brief Log the A* expansions of the last iteration summed over the threads and reset the counters
+ */
+void aStarRoute::logSearchTrace()
+{
+	SearchTrace total;
+	for (SearchTrace& trace : searchTraceForThreads) {
+		total.nodesPushed += trace.nodesPushed;
+		total.nodesPopped += trace.nodesPopped;
+		total.connections += trace.connections;
+		total.failures += trace.failures;
+		total.bidirectional += trace.bidirectional;
+		total.repairs += trace.repairs;
+		total.scratchGrowths += trace.scratchGrowths;
+		total.coneSearches += trace.coneSearches;
+		total.sparseFallbacks += trace.sparseFallbacks;
+		total.boundedSearches += trace.boundedSearches;
+		total.restoredPaths += trace.restoredPaths;
+		total.boundPruned += trace.boundPruned;
+		total.netTrees += trace.netTrees;
+		total.conePruned += trace.conePruned;
+		total.pinSwaps += trace.pinSwaps;
+		total.corridorSearches += trace.corridorSearches;
+		total.corridorFallbacks += trace.corridorFallbacks;
+		total.corridorPruned += trace.corridorPruned;
+		trace = SearchTrace();
+	}
+	log() << "  search: " << total.connections << " connections, " << total.failures << " failed, " << total.nodesPopped << " popped, " << total.nodesPushed << " pushed, "
+		  << std::setprecision(1) << (total.connections > 0 ? total.nodesPopped * 1.0 / total.connections : 0) << " popped/connection, " << total.bidirectional << " bidirectional, " << total.repairs << " repaired, heuristic weight " << scheduledEstWLWeight << std::endl;
+	size_t scratchBytes = 0;
+	for (const SearchScratch& scratch : scratchForThreads)
+		scratchBytes += scratch.capacityBytes();
+	log() << "  scratch: " << total.scratchGrowths << " searches grew a buffer, " << (scratchBytes >> 10) << " KB held by " << scratchForThreads.size() << " threads" << std::endl;
+	if (total.sparseFallbacks > 0)
+		log() << "  sparse: " << total.sparseFallbacks << " connections searched again on the full graph" << std::endl;
+	if (corridorPass)
+		log() << "  corridors: " << total.corridorSearches << " searches pruned " << total.corridorPruned << " children, " << total.corridorFallbacks << " searched again on the whole graph" << std::endl;
+	if (options.netTreeFanout > 0)
+		log() << "  trees: " << total.netTrees << " nets rebuilt as a whole" << std::endl;
+	if (options.lutPinSwapping)
+		log() << "  pins: " << total.pinSwaps << " connections moved to another LUT input" << std::endl;
+	if (options.costBound)
+		log() << "  bound: " << total.boundedSearches << " bounded searches pruned " << total.boundPruned << " children, " << total.restoredPaths << " kept their old path" << std::endl;
+	if (options.reachConeMB > 0)
+		log() << "  cones: " << total.coneSearches << " searches pruned " << total.conePruned << " children, " << reachCones.getNumCones() << " cones cached in "
+			  << (reachCones.getUsedBytes() >> 10) << " KB, " << reachCones.getNumEvicted() << " evicted, " << reachCones.getNumRejected() << " larger than the cache" << std::endl;
+}
+
+/**
+ * @brief Relax the heuristic weight of the next iteration (options.heuristicWeightStart).
+ * The weight moves from the start weight to estWLWeight in proportion to the overused nodes left, relative to the most seen so far.
+ * Early iterations only need rough paths and search greedily; the last ones, which resolve the remaining overuse, search near-admissibly.
+ */
+void aStarRoute::updateHeuristicWeight()
+{
+	if (options.heuristicWeightStart <= 0) {
+		scheduledEstWLWeight = estWLWeight;
+		return;
+	}
+	int overused = numOverUsedRNodes.load();
+	peakOverusedNodeNum = std::max(peakOverusedNodeNum, overused);
+	double ratio = peakOverusedNodeNum > 0 ? overused * 1.0 / peakOverusedNodeNum : 1;
+	scheduledEstWLWeight = estWLWeight + (options.heuristicWeightStart - estWLWeight) * ratio;
+}
+
+/**
+ * @brief Get the heuristic weight of a connection.
+ * With options.adaptiveHeuristic, a connection whose last search popped more than heuristicExploreBudget nodes per tile of its HPWL
+ * gets a weight up to heuristicMaxBoost times larger, growing with the square root of the excess.
+ */
+double aStarRoute::getEstWLWeight(const Connection& connection)
+{
+	if (!options.adaptiveHeuristic || connection.getNumNodesExplored() <= 0)
+		return scheduledEstWLWeight;
+	int hpwl = (connection.getXMax() - connection.getXMin()) + (connection.getYMax() - connection.getYMin()) + 1;
+	double excess = connection.getNumNodesExplored() / (heuristicExploreBudget * hpwl);
+	return scheduledEstWLWeight * std::clamp(std::sqrt(excess), 1.0, heuristicMaxBoost);
+}
+
+/**
+ * @brief Build the parents of all route nodes (the reverse routing graph) for the backward half of bidirectional search and the reachability cones.
+ * The children do not change during routing, so they are built once.
+ */
+void aStarRoute::buildParents()
+{
+	auto& rnodes = database.routingGraph.routeNodes;
+	int numNodes = database.numNodes;
+	parentOffsets.assign(numNodes + 1, 0);
+	for (int i = 0; i < numNodes; i ++)
+		for (auto childRNode : rnodes[i].getChildren())
+			parentOffsets[childRNode->getId() + 1] ++;
+	for (int i = 0; i < numNodes; i ++)
+		parentOffsets[i + 1] += parentOffsets[i];
+	parentIds.resize(parentOffsets[numNodes]);
+	vector<int> fill(parentOffsets.begin(), parentOffsets.end() - 1);
+	for (int i = 0; i < numNodes; i ++)
+		for (auto childRNode : rnodes[i].getChildren())
+			parentIds[fill[childRNode->getId()] ++] = i;
+	log() << "Built the reverse routing graph: " << parentIds.size() << " edges" << std::endl;
+}
+
+/**
+ * @brief Build the sparse graph of the first iterations (options.sparseIterations), where congestion is low and the searches find
+ * near-shortest paths. Of the wire children of a node that go in the same direction with the same length, only the
+ * sparseChildrenPerGroup cheapest are kept; pins and the other node types are always kept. The kept children are stored apart from
+ * the children lists, in their order there, so that the full graph and the tie-breaking of its searches are unchanged.
+ */
+void aStarRoute::buildSparseGraph()
+{
+	auto& rnodes = database.routingGraph.routeNodes;
+	int numNodes = database.numNodes;
+	sparseOffsets.assign(numNodes + 1, 0);
+	std::atomic<long long> totalEdges{0};
+	const int chunkSize = 1 << 16;
+	int numChunks = (numNodes + chunkSize - 1) / chunkSize;
+	vector<vector<RouteNode*>> chunkChildren(numChunks); // the sparse children of the nodes of a chunk, node by node
+	runJobsMT(numChunks, numThread, [&](int chunk) {
+		vector<std::tuple<int, float, int>> wires; // (group, base cost, position) of the wire children
+		vector<char> keep;
+		long long total = 0;
+		for (int id = chunk * chunkSize; id < std::min(numNodes, (chunk + 1) * chunkSize); id ++) {
+			RouteNode& rnode = rnodes[id];
+			const auto& children = rnode.getChildren();
+			wires.clear();
+			keep.assign(children.size(), 1);
+			for (int i = 0; i < children.size(); i ++) {
+				const RouteNode* child = children[i];
+				if (child->getNodeType() != WIRE) continue;
+				int dx = (child->getEndTileXCoordinate() > rnode.getEndTileXCoordinate()) - (child->getEndTileXCoordinate() < rnode.getEndTileXCoordinate());
+				int dy = (child->getEndTileYCoordinate() > rnode.getEndTileYCoordinate()) - (child->getEndTileYCoordinate() < rnode.getEndTileYCoordinate());
+				int group = (((dx + 1) * 3 + dy + 1) << 16) | (unsigned short)child->getLength();
+				wires.emplace_back(group, child->getBaseCost(), i);
+			}
+			std::sort(wires.begin(), wires.end());
+			for (int w = 0, rank = 0; w < wires.size(); w ++) {
+				rank = (w > 0 && std::get<0>(wires[w]) == std::get<0>(wires[w - 1])) ? rank + 1 : 0;
+				if (rank >= sparseChildrenPerGroup)
+					keep[std::get<2>(wires[w])] = 0;
+			}
+
+			size_t numKept = chunkChildren[chunk].size();
+			for (int i = 0; i < children.size(); i ++)
+				if (keep[i]) chunkChildren[chunk].push_back(children[i]);
+			sparseOffsets[id + 1] = chunkChildren[chunk].size() - numKept;
+			total += children.size();
+		}
+		totalEdges += total;
+	});
+	for (int id = 0; id < numNodes; id ++)
+		sparseOffsets[id + 1] += sparseOffsets[id];
+	sparseChildren.clear();
+	sparseChildren.reserve(sparseOffsets[numNodes]);
+	for (auto& children : chunkChildren) {
+		sparseChildren.insert(sparseChildren.end(), children.begin(), children.end());
+		vector<RouteNode*>().swap(children);
+	}
+	log() << "Built the sparse graph of the first " << options.sparseIterations << " iterations: " << sparseChildren.size() << " of " << totalEdges.load() << " edges" << std::endl;
+}
+
+/**
+ * @brief Route all connections on a coarse grid of gcells (options.gcellSize tiles wide) whose boundaries can take as many nets as
+ * wires of the device cross them (see GlobalRouter). The searches of the first options.corridorIterations iterations stay in the
+ * gcells of the coarse path of their connection and its neighbours, so that the detailed negotiation starts from a plan that
+ * already spreads the demand over the regions of the device.
+ */
+void aStarRoute::planCorridors()
+{
+	utils::timer timer;
+	globalRouter.buildCapacity(database.routingGraph.routeNodes, database.numNodes, options.gcellSize, numThread);
+	globalRouter.route(database.nets, database.indirectConnections);
+	log() << "Planned the corridors of the first " << options.corridorIterations << " iterations on " << globalRouter.getNumGCells() << " gcells in "
+		  << std::fixed << std::setprecision(2) << timer.elapsed() << "s" << std::endl;
+}
+
+/**
+ * @brief Order the connections of the nets with at least options.netTreeFanout connections for routing as a tree (see routeNetTree()).
+ * The order follows Prim's algorithm on the pins: the next sink is the one closest (in Manhattan distance) to the source and the
+ * sinks ordered before it, so that each connection has a nearby tree to grow from.
+ */
+void aStarRoute::buildNetTreeOrders()
+{
+	netTreeOrders.assign(database.nets.size(), vector<int>());
+	int numTreeNets = 0;
+	for (int netId = 0; netId < database.nets.size(); netId ++) {
+		const auto& connectionIds = database.nets[netId].getConnectionsByRef();
+		int numSinks = connectionIds.size();
+		if (numSinks < options.netTreeFanout)
+			continue;
+		numTreeNets ++;
+		RouteNode* sourceRNode = database.indirectConnections[connectionIds[0]].getSourceRNode();
+		auto distance = [&](int connectionId, int x, int y) {
+			RouteNode* sinkRNode = database.indirectConnections[connectionId].getSinkRNode();
+			return mkl_utils::scalar_abs(sinkRNode->getBeginTileXCoordinate() - x) + mkl_utils::scalar_abs(sinkRNode->getBeginTileYCoordinate() - y);
+		};
+		// distanceToTree[i]: from the sink of connectionIds[i] to the closest pin already in the tree
+		vector<int> distanceToTree(numSinks);
+		vector<bool> inTree(numSinks, false);
+		for (int i = 0; i < numSinks; i ++)
+			distanceToTree[i] = distance(connectionIds[i], sourceRNode->getEndTileXCoordinate(), sourceRNode->getEndTileYCoordinate());
+		auto& order = netTreeOrders[netId];
+		for (int k = 0; k < numSinks; k ++) {
+			int next = -1;
+			for (int i = 0; i < numSinks; i ++)
+				if (!inTree[i] && (next < 0 || distanceToTree[i] < distanceToTree[next]))
+					next = i;
+			inTree[next] = true;
+			order.push_back(connectionIds[next]);
+			RouteNode* joined = database.indirectConnections[connectionIds[next]].getSinkRNode();
+			for (int i = 0; i < numSinks; i ++)
+				if (!inTree[i])
+					distanceToTree[i] = std::min(distanceToTree[i], distance(connectionIds[i], joined->getBeginTileXCoordinate(), joined->getBeginTileYCoordinate()));
+		}
+	}
+	log() << "Nets routed as trees: " << numTreeNets << " with at least " << options.netTreeFanout << " connections" << std::endl;
+}
+
+/**
+ * @brief Rebuild the routing tree of a net in one task (options.netTreeFanout). If any connection of the net needs routing,
+ * all are ripped up and routed again in the order of netTreeOrders, each from the tree of the connections routed before it.
+ * 
+ * @param netId 
+ * @param tid The ID of the executing thread, which owns the whole net.
+ * @return the number of connections that failed to route
+ */
+int aStarRoute::routeNetTree(int netId, int tid)
+{
+	const auto& order = netTreeOrders[netId];
+	bool needsRouting = false;
+	for (int connectionId : order)
+		needsRouting = needsRouting || shouldRoute(database.indirectConnections[connectionId]);
+	if (!needsRouting)
+		return 0;
+
+	for (int connectionId : order)
+		ripup(database.indirectConnections[connectionId], false);
+	int failures = 0;
+	for (int connectionId : order) {
+		if (!routeOneConnection(connectionId, tid, false, true)) {
+			failures ++;
+			auto& connection = database.indirectConnections[connectionId];
+			log() << "Routing failure. Connection "<< connection << " Coordinate: [" << connection.getSourceRNode()->getEndTileXCoordinate() << " " << connection.getSinkRNode()->getEndTileXCoordinate() << " " << connection.getSourceRNode()->getEndTileYCoordinate() << " " << connection.getSinkRNode()->getEndTileYCoordinate() << "] " << std::endl;
+		}
+	}
+	if (options.traceSearch)
+		searchTraceForThreads[tid].netTrees ++;
+	return failures;
+}
+
+/**
+ * @brief Get the reverse-reachability cone of the sink of a connection (options.reachConeMB): the cached one if it was built in a
+ * bounding box at least as large as the connection's, otherwise a new one from a breadth-first search over the parents inside the box.
+ * With options.lutPinSwapping, the cone of a swappable connection grows from all its equivalent pins and is cached under the placed sink.
+ * Only connections whose last search popped more than heuristicExploreBudget nodes per tile of HPWL get a cone; the others find
+ * their sink before they could waste many expansions.
+ *
+ * @return the cone, nullptr if the connection does not need one
+ */
+std::shared_ptr<const ReachCone> aStarRoute::getReachCone(int connectionId, int tid)
+{
+	const Connection& connection = database.indirectConnections[connectionId];
+	if (options.reachConeMB <= 0 || connection.getNumNodesExplored() <= 0)
+		return nullptr;
+	int hpwl = (connection.getXMax() - connection.getXMin()) + (connection.getYMax() - connection.getYMin()) + 1;
+	if (connection.getNumNodesExplored() <= heuristicExploreBudget * hpwl)
+		return nullptr;
+
+	int sinkId = connection.getPlacedSink();
+	std::shared_ptr<const ReachCone> cached = reachCones.find(sinkId);
+	if (cached != nullptr && cached->covers(connection.getXMinBB(), connection.getXMaxBB(), connection.getYMinBB(), connection.getYMaxBB()))
+		return cached;
+
+	std::call_once(parentsBuilt, &aStarRoute::buildParents, this);
+	auto& rnodes = database.routingGraph.routeNodes;
+	auto& nodeInfos = nodeInfosForThreads[tid];
+	int label = -2 - coneBuilds ++; // never a connection id
+	vector<int> members = {sinkId};
+	if (options.lutPinSwapping && !connection.getEquivalentSinkRNodes().empty()) {
+		members.clear();
+		for (RouteNode* equivalentSink : connection.getEquivalentSinkRNodes())
+			members.push_back(equivalentSink->getId());
+	}
+	for (int memberId : members)
+		nodeInfos[memberId].isVisitedBackward = label;
+	for (size_t head = 0; head < members.size(); head ++) {
+		int rnodeId = members[head];
+		for (int i = parentOffsets[rnodeId]; i < parentOffsets[rnodeId + 1]; i ++) {
+			int parentId = parentIds[i];
+			NodeInfo& parentInfo = nodeInfos[parentId];
+			if (parentInfo.isVisitedBackward == label) continue;
+			if (!isAccessible(&rnodes[parentId], connectionId)) continue;
+			parentInfo.isVisitedBackward = label;
+			members.push_back(parentId);
+		}
+	}
+
+	auto cone = std::make_shared<ReachCone>();
+	cone->xMinBB = connection.getXMinBB();
+	cone->xMaxBB = connection.getXMaxBB();
+	cone->yMinBB = connection.getYMinBB();
+	cone->yMaxBB = connection.getYMaxBB();
+	std::sort(members.begin(), members.end());
+	members.shrink_to_fit();
+	cone->members = std::move(members);
+	reachCones.insert(sinkId, cone);
+	return cone;
+}
+
+/**
+ * @brief Check if the connection is long enough for bidirectional search (options.bidirectionalHpwl).
+ * The HPWL is taken from the source and sink pins, the bounding box margins do not count.
+ */
+bool aStarRoute::isBidirectional(const Connection& connection)
+{
+	if (options.bidirectionalHpwl <= 0) return false;
+	return (connection.getXMax() - connection.getXMin()) + (connection.getYMax() - connection.getYMin()) >= options.bidirectionalHpwl;
+}
+
+/**
+ * @brief Check the negotiation loop against the time budget after an iteration.
+ * The remaining iterations are projected linearly from the last decrease of overused nodes.
+ * If they do not fit into the remaining budget, the congestion factors grow faster (budgetBoost) to trade quality for convergence speed.
+ * 
+ * @return false if the next iteration cannot finish before the deadline
+ */
+bool aStarRoute::updateTimeBudget(double avgIterTime, int overusedNodeNum, int decreaseOfCongestedNodes)
+{
+	double remaining = options.timeBudget * (1 - budgetReserveRatio) - routeTimer.elapsed();
+	if (remaining < avgIterTime)
+		return false;
+
+	double projectedIters = decreaseOfCongestedNodes > 0 ? std::ceil(overusedNodeNum * 1.0 / decreaseOfCongestedNodes) : maxIter - iter;
+	if (projectedIters * avgIterTime > remaining) {
+		budgetBoost = std::min(budgetBoost * 1.25f, 8.0f);
+		log() << "Time budget: " << projectedIters << " more iterations projected, " << std::setprecision(2) << remaining << "s left. Congestion boost " << budgetBoost << std::endl;
+	} else {
+		budgetBoost = std::max(budgetBoost * 0.8f, 1.0f);
+	}
+	return true;
 }
 
 /**
@@ -225,6 +677,7 @@ void aStarRoute::saveAllRoutingSolutions()
 	auto& rnodes = database.routingGraph.routeNodes;
 	nodeRoutingResults.resize(rnodes.size());
 	int fixedNetNum = 0; // multi-driver
+	std::atomic<int> unroutedNum{0};
 	auto saveOneNet = [&](int netId) {
 		const auto& net = database.nets[netId];
 		std::set<RouteNode*> netRNodes;
@@ -232,6 +685,10 @@ void aStarRoute::saveAllRoutingSolutions()
 		for (int connId : net.getConnections()) {
 			Connection& conn = database.indirectConnections[connId];
 			const auto& connRNodes = conn.getRNodes();
+			if (connRNodes.empty()) { // failed in the last iteration, the sink is left unrouted
+				unroutedNum ++;
+				continue;
+			}
 			// source sitePin to source int node
 			vector<obj_idx> totalPath = conn.getSourceToIntPath();
 			assert_t(totalPath[0] == net.getIndirectSourcePin()); // TODO: move the checker to the database checking
@@ -290,6 +747,8 @@ void aStarRoute::saveAllRoutingSolutions()
 	};
 	runJobsMT(database.numNets, numThread, saveOneNet);
 	log() << "FixedNetNum: " << fixedNetNum << " / " << database.nets.size() << std::endl;
+	if (unroutedNum.load() > 0)
+		log(LOG_ERROR) << "Unrouted connections: " << unroutedNum.load() << " / " << database.numConns << std::endl;
 	log() << "Save all routing solutions [Finish]" << std::endl;
 }
 
@@ -352,6 +811,8 @@ void aStarRoute::fixNetRoutes(const Net& net, std::set<RouteNode*>& netRNodes)
 	// mark rnode and remove useless rnodes
 	unordered_set<RouteNode*> inRoute;
 	for (RouteNode* rnode : sinkPins) {
+		if (netRNodes.find(rnode) == netRNodes.end())
+			continue; // unrouted
 		assert_t(rnode->getNodeType() == PINFEED_I);
 		int watchDog = 0;
 		while (rnode != sourcePin) {
@@ -374,12 +835,77 @@ void aStarRoute::fixNetRoutes(const Net& net, std::set<RouteNode*>& netRNodes)
 }
 
 /**
- * @brief update the bounding box of an indirect connection
+ * @brief Build the RPTT on the current connection bounding boxes. Leaf nodes scheduled together must not overlap,
+ * so the tree is rebuilt whenever an adaptive bounding box changed.
+ */
+void aStarRoute::buildPartitionTree()
+{
+	if (partitionTree != nullptr)
+		delete partitionTree;
+	utils::BoxT<int> bbox;
+	for (auto& conn: database.indirectConnections) {
+		bbox = bbox.UnionWith(conn.getBBox());
+	}
+	log() << "Connections bbox: " << bbox << std::endl;
+	partitionTree = new PartitionTree(database.indirectConnections, sortedConnectionIds, bbox);
+	partitionTree->calculateNodeLevel();
+	scheduledLevel = partitionTree->schedule(partitionTree->getLeafNodes());
+	log() << "Schedule Level: " << scheduledLevel << std::endl;
+	isPartitionTreeStale = false;
+}
+
+/**
+ * @brief Adapt the bounding box margins of the connections after an iteration.
+ * A failed connection doubles its margins, one congested for two iterations in a row grows them by one step,
+ * and one routed without congestion for three iterations in a row shrinks them back toward the start by one step.
  * 
- * @param x_margin the margin in x-axis
- * @param y_margin the margin in y-axis
+ * @return true if any margin changed
  */
-void aStarRoute::updateIndirectConnectionBBox(int x_margin, int y_margin) {
+bool aStarRoute::updateAdaptiveMargins()
+{
+	int grown = 0;
+	int shrunk = 0;
+	long long xMarginSum = 0;
+	long long yMarginSum = 0;
+	for (auto& conn : database.indirectConnections) {
+		bool failed = !conn.getRouted();
+		bool congested = !failed && congestedFlags[conn.getId()] && conn.isCongested();
+		int streak = conn.getBBoxStreak();
+		streak = (failed || congested) ? std::max(streak, 0) + 1 : std::min(streak, 0) - 1;
+		conn.setBBoxStreak(streak);
+
+		int x = conn.getXMargin();
+		int y = conn.getYMargin();
+		if (failed) {
+			x = std::min(2 * x, adaptiveXMarginMax);
+			y = std::min(2 * y, adaptiveYMarginMax);
+		} else if (streak >= 2) {
+			x = std::min(x + 1, adaptiveXMarginMax);
+			y = std::min(y + adaptiveYMarginStart / 2, adaptiveYMarginMax);
+		} else if (streak <= -3) {
+			x = std::max(x - 1, adaptiveXMarginStart);
+			y = std::max(y - adaptiveYMarginStart / 2, adaptiveYMarginStart);
+		}
+		if (x > conn.getXMargin() || y > conn.getYMargin())
+			grown ++;
+		else if (x < conn.getXMargin() || y < conn.getYMargin())
+			shrunk ++;
+		conn.setMargins(x, y);
+		xMarginSum += x;
+		yMarginSum += y;
+	}
+	int numConns = std::max<int>(1, database.indirectConnections.size());
+	log() << "  bbox: " << grown << " grown, " << shrunk << " shrunk, mean margin " << std::fixed << std::setprecision(2)
+		  << xMarginSum * 1.0 / numConns << " x " << yMarginSum * 1.0 / numConns << std::endl;
+	return grown + shrunk > 0;
+}
+
+/**
+ * @brief update the bounding boxes of the indirect connections from their margins and those of the nets.
+ * A bounding box always keeps the connection's current path inside, so that a later rip-up stays within it.
+ * 
+ */
+void aStarRoute::updateIndirectConnectionBBox() {
 	for (int netId = 0; netId < database.nets.size(); netId++) {
 		Net& net = database.nets[netId];
 		if (net.getConnectionSize() == 0)
@@ -392,14 +918,20 @@ void aStarRoute::updateIndirectConnectionBBox(int x_margin, int y_margin) {
 
 		for (int connId: net.getConnections()) {
 			Connection& conn = database.indirectConnections[connId];
-			int x_min = conn.getXMin() - x_margin;
+			int x_min = conn.getXMin() - conn.getXMargin();
 			if (x_min < 0) x_min = -1;
-			int x_max = conn.getXMax() + x_margin;
+			int x_max = conn.getXMax() + conn.getXMargin();
 			if (x_max > database.layout.hx()) x_max = database.layout.hx();
-			int y_min = conn.getYMin() - y_margin;
+			int y_min = conn.getYMin() - conn.getYMargin();
 			if (y_min < 0) y_min = -1;
-			int y_max = conn.getYMax() + y_margin;
+			int y_max = conn.getYMax() + conn.getYMargin();
 			if (y_max > database.layout.hy()) y_max = database.layout.hy();
+			for (const RouteNode* rnode : conn.getRNodes()) { // isAccessible() excludes the boundary
+				x_min = std::min(x_min, rnode->getEndTileXCoordinate() - 1);
+				x_max = std::max(x_max, rnode->getEndTileXCoordinate() + 1);
+				y_min = std::min(y_min, rnode->getEndTileYCoordinate() - 1);
+				y_max = std::max(y_max, rnode->getEndTileYCoordinate() + 1);
+			}
 			conn.updateBBox(x_min, y_min, x_max, y_max);
 			conn.computeHPWL();
 			net.updateXMinBB(x_min);
@@ -411,6 +943,182 @@ void aStarRoute::updateIndirectConnectionBBox(int x_margin, int y_margin) {
 	}
 }
 
+/**
+ * @brief Snapshot the negotiation state and write it to the checkpoint file in a background thread.
+ * The snapshot is taken synchronously between two iterations; only the file writing overlaps with routing.
+ * If the previous checkpoint is still being written, this one is skipped.
+ *
+ * @param checkpoint a checkpoint whose loop statistics are already filled. Its ownership is taken.
+ */
+void aStarRoute::saveCheckpoint(RouteCheckpoint* checkpoint)
+{
+	if (isWritingCheckpoint.load()) {
+		log() << "Checkpoint of iteration " << checkpoint->iter << " skipped: the previous one is still being written" << std::endl;
+		delete checkpoint;
+		return;
+	}
+	waitForCheckpointWriter();
+
+	checkpoint->numNodes = database.numNodes;
+	checkpoint->numConns = database.numConns;
+	checkpoint->numNets = database.numNets;
+	checkpoint->connectionHash = RouteCheckpoint::hashConnections(database.indirectConnections);
+	checkpoint->connectionIdBase = connectionIdBase;
+	checkpoint->presentCongestionFactor = presentCongestionFactor;
+	checkpoint->historicalCongestionFactor = historicalCongestionFactor;
+	checkpoint->presentCongestionMultiplier = presentCongestionMultiplier;
+	checkpoint->isCongestedDesign = isCongestedDesign;
+	checkpoint->useOverlapRouting = useOverlapRouting;
+	checkpoint->numOverUsedRNodes = numOverUsedRNodes.load();
+	checkpoint->peakOverusedNodeNum = peakOverusedNodeNum;
+	for (const auto& net : database.nets)
+		checkpoint->numUsers += net.countUsers();
+	checkpoint->captureNodes(database.routingGraph.routeNodes);
+	checkpoint->captureConnections(database.indirectConnections);
+
+	isWritingCheckpoint.store(true);
+	string fileName = options.checkpointFile;
+	checkpointWriter = std::thread([this, checkpoint, fileName]() {
+		utils::timer timer;
+		if (checkpoint->save(fileName))
+			log() << "Checkpoint of iteration " << checkpoint->iter << " written to " << fileName << " (" << checkpoint->nodeIds.size() << " nodes, " << checkpoint->pathNodes.size() << " path nodes) in " << std::fixed << std::setprecision(2) << timer.elapsed() << "s" << std::endl;
+		delete checkpoint;
+		isWritingCheckpoint.store(false);
+	});
+}
+
+void aStarRoute::waitForCheckpointWriter()
+{
+	if (checkpointWriter.joinable())
+		checkpointWriter.join();
+}
+
+/**
+ * @brief Restore the negotiation state from a checkpoint. Must be called after the pre-processing of routeIndirectConnections.
+ *
+ * @return true if the checkpoint belongs to this design and has been applied,
+ * @return false otherwise (nothing is modified)
+ */
+bool aStarRoute::restoreCheckpoint(RouteCheckpoint& checkpoint)
+{
+	if (checkpoint.numNodes != database.numNodes || checkpoint.numConns != database.numConns || checkpoint.numNets != database.numNets ||
+		checkpoint.connectionHash != RouteCheckpoint::hashConnections(database.indirectConnections)) {
+		log(LOG_ERROR) << "Checkpoint " << options.checkpointFile << " does not match this design. Route from scratch." << std::endl;
+		return false;
+	}
+
+	// the users of the nets are rebuilt as ripup() expects them: a connection uses the nodes of its path, or only its sink without a path
+	auto forEachUse = [&](auto&& use) {
+		for (int connId = 0; connId < database.numConns; connId ++) {
+			int netId = database.indirectConnections[connId].getNetId();
+			if (checkpoint.pathOffsets[connId] == checkpoint.pathOffsets[connId + 1])
+				use(netId, checkpoint.sinks[connId]);
+			for (uint32_t i = checkpoint.pathOffsets[connId]; i < checkpoint.pathOffsets[connId + 1]; i ++)
+				use(netId, checkpoint.pathNodes[i]);
+		}
+	};
+	// resume equivalence: the rebuilt users must give the saved number of users and the saved occupancy of every node
+	vector<unordered_map<obj_idx, int>> netUsers(database.nets.size());
+	forEachUse([&](int netId, obj_idx nodeId) { netUsers[netId][nodeId] ++; });
+	long long numUsers = 0;
+	unordered_map<obj_idx, int> occupancies;
+	for (const auto& users : netUsers) {
+		for (const auto& user : users) {
+			numUsers += user.second;
+			occupancies[user.first] ++;
+		}
+	}
+	bool isEquivalent = (numUsers == checkpoint.numUsers);
+	int numOccupied = 0;
+	for (int i = 0; i < checkpoint.nodeIds.size() && isEquivalent; i ++) {
+		if (checkpoint.occupancies[i] == 0) continue;
+		auto it = occupancies.find(checkpoint.nodeIds[i]);
+		isEquivalent = (it != occupancies.end() && it->second == checkpoint.occupancies[i]);
+		numOccupied ++;
+	}
+	if (!isEquivalent || numOccupied != occupancies.size()) {
+		log(LOG_ERROR) << "Checkpoint " << options.checkpointFile << " does not give back its node occupancy. Route from scratch." << std::endl;
+		return false;
+	}
+
+	auto& rnodes = database.routingGraph.routeNodes;
+	for (auto& rnode : rnodes) {
+		rnode.setOccupancy(0);
+		rnode.setPresentCongestionCost(1);
+		rnode.setHistoricalCongestionCost(1);
+	}
+	for (int i = 0; i < checkpoint.nodeIds.size(); i ++) {
+		RouteNode& rnode = rnodes[checkpoint.nodeIds[i]];
+		rnode.setOccupancy(checkpoint.occupancies[i]);
+		rnode.setPresentCongestionCost(checkpoint.presentCosts[i]);
+		rnode.setHistoricalCongestionCost(checkpoint.historicalCosts[i]);
+	}
+
+	// the node occupancy is restored above; the users of the pre-processing (updateSinkNodeUsage) are replaced
+	restorePaths(checkpoint);
+	for (auto& net : database.nets)
+		net.clearUsers();
+	forEachUse([&](int netId, obj_idx nodeId) { database.nets[netId].incrementUser(&rnodes[nodeId]); });
+	for (int connId = 0; connId < database.numConns; connId ++) {
+		Connection& connection = database.indirectConnections[connId];
+		connection.setMargins(checkpoint.xMargins[connId], checkpoint.yMargins[connId]);
+		connection.setBBoxStreak(checkpoint.bboxStreaks[connId]);
+		if (connection.getRouted())
+			indexPath(connId); // flags the connection if the restored occupancy overuses its path
+	}
+
+	connectionIdBase = checkpoint.connectionIdBase;
+	presentCongestionFactor = checkpoint.presentCongestionFactor;
+	historicalCongestionFactor = checkpoint.historicalCongestionFactor;
+	presentCongestionMultiplier = checkpoint.presentCongestionMultiplier;
+	isCongestedDesign = checkpoint.isCongestedDesign;
+	useOverlapRouting = checkpoint.useOverlapRouting;
+	numOverUsedRNodes.store(checkpoint.numOverUsedRNodes);
+	peakOverusedNodeNum = checkpoint.peakOverusedNodeNum;
+
+	// the bounding boxes of the pre-processing used the start margins and did not hold the restored paths
+	updateIndirectConnectionBBox();
+	isPartitionTreeStale = true;
+	return true;
+}
+
+/**
+ * @brief Put the connection paths and sinks of a checkpoint back, without the node occupancy and the users of nets.
+ * A connection may end at another pin than its placed sink if the checkpoint was taken after a pin swap.
+ *
+ */
+void aStarRoute::restorePaths(const RouteCheckpoint& checkpoint)
+{
+	auto& rnodes = database.routingGraph.routeNodes;
+	for (int connId = 0; connId < database.numConns; connId ++) {
+		Connection& connection = database.indirectConnections[connId];
+		unindexPath(connId);
+		connection.resetRoute();
+		for (uint32_t i = checkpoint.pathOffsets[connId]; i < checkpoint.pathOffsets[connId + 1]; i ++)
+			connection.addRNode(&rnodes[checkpoint.pathNodes[i]]);
+		connection.setRouted(checkpoint.routed[connId]);
+		if (checkpoint.sinks[connId] != connection.getSink())
+			connection.swapSink(&rnodes[checkpoint.sinks[connId]]);
+	}
+	applyPinSwaps();
+}
+
+/**
+ * @brief Move the sinks of the nets to the pins their connections were swapped to (options.lutPinSwapping).
+ * A search only swaps the sink of its own connection; the nets are shared by the threads and follow here, between iterations.
+ */
+void aStarRoute::applyPinSwaps()
+{
+	for (auto& net : database.nets) {
+		const auto& connectionIds = net.getConnectionsByRef();
+		for (int i = 0; i < connectionIds.size(); i ++) {
+			RouteNode* sinkRNode = database.indirectConnections[connectionIds[i]].getSinkRNode();
+			if (net.getIndirectSinkRNode(i) != sinkRNode)
+				net.setIndirectSink(i, sinkRNode);
+		}
+	}
+}
+
 /**
  * @brief Increase the sink node usage for each connection.
  * This is to avoid the sink node of a net is used by another net and this congestion is not found.
@@ -451,20 +1159,55 @@ void aStarRoute::sortConnections()
 }
 
 /**
- * @brief route a connection
+ * @brief Route one connection with the A* kernel specialized for the calling phase.
  * 
  * @param connectionId id of the connection to be routed
  * @param tid id of the executing thread
- * @param sync true if synchronization barrier is needed
+ * @param sync true in stable-first routing, where the occupancy changes of the current batch are not committed yet
+ * @param fromNetTree also start from the nodes used by the other connections of the net. Only if the calling thread owns the whole net.
  * @return true if the connection is successfully routed,
  * @return false otherwise
  */
-bool aStarRoute::routeOneConnection(int connectionId, int tid, bool sync) 
+bool aStarRoute::routeOneConnection(int connectionId, int tid, bool sync, bool fromNetTree, double costBound)
 {
 	// mutex.lock();
 	// routedConnectionNum ++;
 	// mutex.unlock();
 	incrementRoutedConnectionNum();
+	return searchConnection(connectionId, tid, sync, fromNetTree, costBound, nullptr);
+}
+
+/**
+ * @brief Run the A* kernel specialized for the calling phase on a connection or on a repair window of it.
+ * In the first iterations (options.sparseIterations, options.corridorIterations), the search is restricted to the sparse graph
+ * and the corridor of the connection; the whole graph is only searched when the restricted search has no path.
+ */
+bool aStarRoute::searchConnection(int connectionId, int tid, bool sync, bool fromNetTree, double costBound, const RepairWindow* window)
+{
+	auto search = [&](bool sparse, bool corridor) {
+		if (sync)
+			return options.traceSearch ? routeOneConnectionKernel<true, true>(connectionId, tid, fromNetTree, sparse, corridor, costBound, window) : routeOneConnectionKernel<true, false>(connectionId, tid, fromNetTree, sparse, corridor, costBound, window);
+		return options.traceSearch ? routeOneConnectionKernel<false, true>(connectionId, tid, fromNetTree, sparse, corridor, costBound, window) : routeOneConnectionKernel<false, false>(connectionId, tid, fromNetTree, sparse, corridor, costBound, window);
+	};
+	bool corridor = corridorPass && globalRouter.hasCorridor(connectionId);
+	if ((sparsePass || corridor) && search(sparsePass, corridor))
+		return true;
+	return search(false, false);
+}
+
+/**
+ * @brief The A* search of routeOneConnection(). The policies are resolved at compile time, so the expansion loop carries no mode checks.
+ * 
+ * @tparam Sync see routeOneConnection()
+ * @tparam Trace count the pushed and popped nodes into searchTraceForThreads
+ * @param sparse expand only the children kept in the sparse graph (see buildSparseGraph())
+ * @param corridor push only the nodes ending in the corridor of the connection (see planCorridors())
+ * @param costBound nodes whose total cost exceeds it are not pushed; infinity: unbounded
+ * @param window if not null, search only from the source-side end to the sink-side end of the window and leave the splicing to repairConnection()
+ */
+template <bool Sync, bool Trace>
+bool aStarRoute::routeOneConnectionKernel(int connectionId, int tid, bool fromNetTree, bool sparse, bool corridor, double costBound, const RepairWindow* window)
+{
 	auto& connection = database.indirectConnections[connectionId];
 	auto& net = database.nets[connection.getNetId()];
 	auto& rnodes = database.routingGraph.routeNodes;
@@ -475,18 +1218,20 @@ bool aStarRoute::routeOneConnection(int connectionId, int tid, bool sync)
 		return (nodeInfos[lhs->getId()].cost > nodeInfos[rhs->getId()].cost);
 	};
 
-	// Reserve capacity for priority_queue based on connection bbox to reduce reallocations
-	int bbox_width = connection.getXMax() - connection.getXMin() + 1;
-	int bbox_height = connection.getYMax() - connection.getYMin() + 1;
-	int bbox_area = std::max(1, bbox_width * bbox_height);  // Ensure at least 1
-	// Estimate nodes to explore: empirical factor of 10x bbox area, capped at 100k
-	int estimated_nodes = std::min(bbox_area * 10, 100000);
-	std::vector<RouteNode*> pq_container;
-	pq_container.reserve(estimated_nodes);
-
-	// std::priority_queue<int, vector<int>, decltype(nodeInfoComp)> nodeInfoQueue(nodeInfoComp);
-	std::priority_queue<RouteNode*, vector<RouteNode*>, decltype(rnodeComp)> rnodeQueue(rnodeComp, std::move(pq_container));
-	int connectionUniqueId = connectionId + connectionIdBase;
+	// the open list lives in the thread's scratch and keeps its capacity between connections
+	SearchScratch& scratch = scratchForThreads[tid];
+	size_t scratchBytes = 0;
+	if constexpr (Trace) scratchBytes = scratch.capacityBytes();
+	HeapView<RouteNode*, decltype(rnodeComp)> rnodeQueue(scratch.forwardHeap, rnodeComp);
+	// in a sparse or corridor iteration, the unrestricted search that follows a failed restricted one labels its nodes apart from it
+	int connectionUniqueId = connectionId + connectionIdBase + ((sparsePass || corridorPass) && !sparse && !corridor ? database.numConns : 0);
+	if (window != nullptr)
+		connectionUniqueId = -connectionUniqueId - 2; // a label of its own, a full search of this connection may follow in the same iteration
+	RouteNode* sourceRNode = window != nullptr ? window->path[window->from] : connection.getSourceRNode();
+	RouteNode* sinkRNode = window != nullptr ? window->path[window->to] : connection.getSinkRNode();
+	int sinkX = sinkRNode->getBeginTileXCoordinate();
+	int sinkY = sinkRNode->getBeginTileYCoordinate();
+	double estWeight = getEstWLWeight(connection);
 
 	auto push = [&](RouteNode* rnode, RouteNode* prev, double cost, double partialCost, int isTarget) {
 		NodeInfo& ninfo = nodeInfos[rnode->getId()];
@@ -494,115 +1239,410 @@ bool aStarRoute::routeOneConnection(int connectionId, int tid, bool sync)
         // has been visited by this connection before
 		ninfo.write(prev, cost, partialCost, connectionUniqueId, isTarget);
 		rnodeQueue.push(rnode);
+		if constexpr (Trace) searchTraceForThreads[tid].nodesPushed ++;
+	};
+
+	const BiasTerms bias = getBiasTerms(connection);
+
+	// software prefetch of the lines an expansion touches: the RouteNode, which may straddle two lines, and the NodeInfo.
+	// The NodeInfo address comes from the position of the node in the graph, so that it does not wait for the RouteNode.
+	const int prefetchDistance = options.prefetchDistance;
+	RouteNode* rnodeBase = rnodes.data();
+	auto prefetch = [&](RouteNode* rnode) {
+		__builtin_prefetch(rnode);
+		__builtin_prefetch(reinterpret_cast<char*>(rnode) + sizeof(RouteNode) - 1);
+		__builtin_prefetch(&nodeInfos[rnode - rnodeBase], 1);
+	};
+	// prefetch the first children of a node to expand, and the next node to expand (the current top of the open list)
+	auto prefetchExpansion = [&](RouteNode* const* children, int numChildren, RouteNode* next) {
+		int warmup = std::min(prefetchDistance, numChildren);
+		for (int i = 0; i < warmup; i ++)
+			prefetch(children[i]);
+		if (next != nullptr)
+			prefetch(next);
+	};
+
+	// cost of passing childRNode for this connection; the sharing factor is returned for the distance estimates
+	auto nodePathCost = [&](RouteNode* childRNode, NodeInfo& childInfo, bool isTarget, double& sharingFactor) {
+		int countSourceUsesOrigin = net.countConnectionsOfUser(childRNode);
+		int countSourceUses = countSourceUsesOrigin;
+		int occChange = 0;
+		if constexpr (Sync) {
+			countSourceUses = countSourceUses - net.getPreDecrementUser(childRNode) + net.getPreIncrementUser(childRNode);
+			occChange = childInfo.getOccChange(currentBatchStamp);
+		}
+		sharingFactor = 1 + sharingWeight * countSourceUses;
+		double nodeCost = getNodeCost<Sync>(childRNode, bias, occChange, countSourceUses, countSourceUsesOrigin, sharingFactor, isTarget);
+		assert_t(nodeCost >= 0);
+		return rnodeCostWeight * nodeCost + rnodeWLWeight * childRNode->getLength() / sharingFactor;
+	};
+
+	// total cost of reaching childRNode from a parent of partial cost parentPartialCost; the partial cost is returned in partialCost
+	auto evaluate = [&](RouteNode* childRNode, NodeInfo& childInfo, double parentPartialCost, bool isTarget, double& partialCost) {
+		double sharingFactor;
+		partialCost = parentPartialCost + nodePathCost(childRNode, childInfo, isTarget, sharingFactor);
+
+		int childX = childRNode->getEndTileXCoordinate();
+		int childY = childRNode->getEndTileYCoordinate();
+		int deltaX = mkl_utils::scalar_abs(childX - sinkX);
+		int deltaY = mkl_utils::scalar_abs(childY - sinkY);
+
+		double distanceToSink = deltaX + deltaY;
+		return partialCost + estWeight * distanceToSink / sharingFactor;
 	};
 
-	push(connection.getSourceRNode(), nullptr, 0, 0, -1);
+	// a path through a child whose total cost exceeds the bound is not cheaper than the old path of the connection.
+	// The estimate is taken at the unboosted weight estWLWeight: the heavier weight of options.heuristicWeightStart or
+	// options.adaptiveHeuristic would overestimate the nodes of the old path itself.
+	const double boundWeightRatio = std::min(1.0, estWLWeight / estWeight);
+	auto exceedsBound = [&](double totalCost, double partialCost) {
+		if (partialCost + (totalCost - partialCost) * boundWeightRatio <= costBound) return false;
+		if constexpr (Trace) searchTraceForThreads[tid].boundPruned ++;
+		return true;
+	};
+	if constexpr (Trace) {
+		if (costBound < std::numeric_limits<double>::infinity()) searchTraceForThreads[tid].boundedSearches ++;
+	}
+
+	// a child outside the reverse-reachability cone of the sink cannot lead to it
+	std::shared_ptr<const ReachCone> cone = getReachCone(connectionId, tid);
+	auto outsideCone = [&](RouteNode* childRNode) {
+		if (cone == nullptr || cone->contains(childRNode->getId())) return false;
+		if constexpr (Trace) searchTraceForThreads[tid].conePruned ++;
+		return true;
+	};
+	if constexpr (Trace) {
+		if (cone != nullptr) searchTraceForThreads[tid].coneSearches ++;
+	}
+
+	// a child ending outside the corridor of the connection is not pushed; the gcells of the corridor carry the label of this search
+	if (corridor) {
+		scratch.corridorMarks.resize(globalRouter.getNumGCells(), -1);
+		globalRouter.markCorridor(connectionId, scratch.corridorMarks, connectionUniqueId);
+	}
+	auto outsideCorridor = [&](RouteNode* childRNode) {
+		if (!corridor || scratch.corridorMarks[globalRouter.getGCell(childRNode->getEndTileXCoordinate(), childRNode->getEndTileYCoordinate())] == connectionUniqueId) return false;
+		if constexpr (Trace) searchTraceForThreads[tid].corridorPruned ++;
+		return true;
+	};
+	if constexpr (Trace) {
+		if (corridor) searchTraceForThreads[tid].corridorSearches ++;
+	}
+
+	// The children of an expansion are evaluated ChildBatch::capacity at a time in SIMD lanes, which also test the bounding box.
+	// A lane holds the exact cost of its child unless the child is the target, whose cost has no bias term, or other
+	// connections of the net use it; those children are evaluated one by one.
+	const bool batchExpansion = options.batchExpansion;
+	ChildBatch& batch = scratch.batch;
+	ChildBatch::Params batchParams;
+	if (batchExpansion) {
+		batchParams.xMinBB = connection.getXMinBB();
+		batchParams.xMaxBB = connection.getXMaxBB();
+		batchParams.yMinBB = connection.getYMinBB();
+		batchParams.yMaxBB = connection.getYMaxBB();
+		batchParams.sinkX = sinkX;
+		batchParams.sinkY = sinkY;
+		batchParams.biasScale = bias.scale;
+		batchParams.xCenter = bias.xCenter;
+		batchParams.yCenter = bias.yCenter;
+		batchParams.rnodeCostWeight = rnodeCostWeight;
+		batchParams.rnodeWLWeight = rnodeWLWeight;
+		batchParams.estWeight = estWeight;
+	}
+	auto evaluateBatch = [&](RouteNode* const* children, int begin, int end, double parentPartialCost) {
+		batch.gather(children + begin, std::min(ChildBatch::capacity, end - begin));
+		batch.evaluate(batchParams, parentPartialCost);
+	};
+	auto evaluateLane = [&](int lane, RouteNode* childRNode, NodeInfo& childInfo, double parentPartialCost, bool isTarget, double& partialCost) {
+		if (!isTarget) {
+			int countSourceUses = net.countConnectionsOfUser(childRNode);
+			if constexpr (Sync)
+				countSourceUses = countSourceUses - net.getPreDecrementUser(childRNode) + net.getPreIncrementUser(childRNode);
+			if (countSourceUses == 0) {
+				partialCost = batch.partialCost[lane];
+				return batch.totalCost[lane];
+			}
+		}
+		return evaluate(childRNode, childInfo, parentPartialCost, isTarget, partialCost);
+	};
+
+	push(sourceRNode, nullptr, 0, 0, -1);
 	
-	NodeInfo& sinkInfo = nodeInfos[connection.getSinkRNode()->getId()];
-	sinkInfo.write(nullptr, 0, 0, -1, connectionUniqueId);
+	const auto& equivalentSinks = connection.getEquivalentSinkRNodes();
+	if (window != nullptr) {
+		// the search does not enter the kept prefix and suffix of the path
+		for (int i = 0; i < window->to; i ++)
+			nodeInfos[window->path[i]->getId()].write(nullptr, 0, 0, connectionUniqueId, -1);
+		for (int i = window->from + 1; i < window->path.size(); i ++)
+			nodeInfos[window->path[i]->getId()].write(nullptr, 0, 0, connectionUniqueId, -1);
+		nodeInfos[sinkRNode->getId()].write(nullptr, 0, 0, -1, connectionUniqueId);
+	} else if (options.lutPinSwapping && !equivalentSinks.empty()) {
+		// any free equivalent pin ends the search; the placed pin always does, so that contended swaps fall back to it
+		for (RouteNode* equivalentSink : equivalentSinks) {
+			if (equivalentSink->getId() != connection.getPlacedSink()) {
+				int countNetUses = net.countConnectionsOfUser(equivalentSink);
+				bool usedByOtherNets = equivalentSink->getOccupancy() > (countNetUses > 0 ? 1 : 0);
+				if constexpr (Sync)
+					countNetUses = countNetUses - net.getPreDecrementUser(equivalentSink) + net.getPreIncrementUser(equivalentSink);
+				if (countNetUses > 0 || usedByOtherNets)
+					continue;
+			}
+			nodeInfos[equivalentSink->getId()].write(nullptr, 0, 0, -1, connectionUniqueId);
+		}
+	} else {
+		NodeInfo& sinkInfo = nodeInfos[connection.getSinkRNode()->getId()];
+		sinkInfo.write(nullptr, 0, 0, -1, connectionUniqueId);
+	}
+
+	// multi-source: grow from the nodes the other connections of the net already use, each reached at its cost along the net's tree
+	if (fromNetTree && net.getConnectionSize() > 1) {
+		for (int otherId : net.getConnectionsByRef()) {
+			if (otherId == connectionId) continue;
+			const auto& path = database.indirectConnections[otherId].getRNodes(); // sink -> source
+			if (path.size() < 3 || path.back() != sourceRNode) continue;
+			// walk from the source, so that the prev of a tree node is always seeded before it; the other sink is skipped
+			for (int i = path.size() - 2; i > 0; i --) {
+				RouteNode* treeRNode = path[i];
+				RouteNode* prev = path[i + 1];
+				NodeInfo& treeInfo = nodeInfos[treeRNode->getId()];
+				if (treeInfo.isVisited == connectionUniqueId) continue; // shared with a path seeded before
+				if (treeRNode == sinkRNode) break;
+				double partialCost;
+				double totalCost = evaluate(treeRNode, treeInfo, nodeInfos[prev->getId()].partialCost, false, partialCost);
+				if (isAccessible(treeRNode, connectionId) && isAccessibleByType(treeRNode, connection, false) && !outsideCone(treeRNode) && !outsideCorridor(treeRNode))
+					push(treeRNode, prev, totalCost, partialCost, -1);
+				else
+					treeInfo.write(prev, totalCost, partialCost, connectionUniqueId, -1); // not expanded, only a link back to the source
+			}
+		}
+	}
 
 	RouteNode* targetRNode = nullptr;
 
 	int nodesPoppedThisConnection = 0;
-	while (!rnodeQueue.empty()) {
-		nodesPoppedThisConnection ++;
-		// int ninfoIdx = nodeInfoQueue.top(); nodeInfoQueue.pop();
-		RouteNode* rnode = rnodeQueue.top(); rnodeQueue.pop();
-		// THIS MAY BE A DANGLING REFERENCE!!!!!
-		NodeInfo& ninfo = nodeInfos[rnode->getId()];
-		// RouteNode* rnode = ninfo.cur;
-		double ninfo_partialCost = ninfo.partialCost;
-		assert_t(rnode != nullptr);
-
-		int childInfoIdx = -1;
-		for (auto childRNode : rnode->getChildren()) {
-			// childInfoIdx = nodeInfos.getIndex(childRNode);
-			NodeInfo& childInfo = nodeInfos[childRNode->getId()];
-			bool isVisited = (childInfo.isVisited == connectionUniqueId);
-			bool isTarget = (childInfo.isTarget == connectionUniqueId);
-
-			if (isVisited) {
-				continue;
+	bool bidirectional = window == nullptr && isBidirectional(connection);
+	if (bidirectional) {
+		// A backward search from the sink, or from every pin it may be swapped to, over the parents meets the forward one. A node is labeled by one side only and is a meeting point for the other.
+		// The path through the meeting edge (from, to) costs partialCost(from) + backwardCost(to), where backwardCost(to) includes the cost of to itself.
+		// The backward side keeps to the same graph as the forward one: the sparse edges, the cone, the corridor and the cost bound.
+		std::call_once(parentsBuilt, &aStarRoute::buildParents, this);
+		using BackwardEntry = SearchScratch::KeyedNode;
+		HeapView<BackwardEntry, std::greater<BackwardEntry>> backwardQueue(scratch.keyedHeap, std::greater<BackwardEntry>());
+		int sourceX = sourceRNode->getEndTileXCoordinate();
+		int sourceY = sourceRNode->getEndTileYCoordinate();
+
+		// the total cost estimate of a backward node, the counterpart of evaluate()
+		auto backwardTotalCost = [&](RouteNode* rnode, double backwardCost, double sharingFactor) {
+			int deltaX = mkl_utils::scalar_abs(rnode->getBeginTileXCoordinate() - sourceX);
+			int deltaY = mkl_utils::scalar_abs(rnode->getBeginTileYCoordinate() - sourceY);
+			return backwardCost + estWeight * (deltaX + deltaY) / sharingFactor;
+		};
+		auto pushBackward = [&](RouteNode* rnode, RouteNode* next, double backwardCost, double totalCost) {
+			nodeInfos[rnode->getId()].writeBackward(next, backwardCost, connectionUniqueId);
+			backwardQueue.emplace(totalCost, rnode);
+			if constexpr (Trace) searchTraceForThreads[tid].nodesPushed ++;
+		};
+		if (options.lutPinSwapping && !equivalentSinks.empty()) {
+			// each pin labeled as a target of the forward search is a start of the backward one
+			for (RouteNode* equivalentSink : equivalentSinks)
+				if (nodeInfos[equivalentSink->getId()].isTarget == connectionUniqueId)
+					pushBackward(equivalentSink, nullptr, 0, backwardTotalCost(equivalentSink, 0, 1));
+		} else {
+			pushBackward(sinkRNode, nullptr, 0, backwardTotalCost(sinkRNode, 0, 1));
+		}
+		// in a sparse pass, the edge (parent, child) is searched only if child is a sparse child of parent
+		auto inSparseGraph = [&](RouteNode* parentRNode, RouteNode* childRNode) {
+			auto begin = sparseChildren.begin() + sparseOffsets[parentRNode->getId()];
+			auto end = sparseChildren.begin() + sparseOffsets[parentRNode->getId() + 1];
+			return std::find(begin, end, childRNode) != end;
+		};
+
+		const double inf = std::numeric_limits<double>::infinity();
+		double bestCost = inf;
+		RouteNode* meetFrom = nullptr; // labeled by the forward search
+		RouteNode* meetTo = nullptr;   // labeled by the backward search
+		auto meet = [&](RouteNode* from, RouteNode* to) {
+			double cost = nodeInfos[from->getId()].partialCost + nodeInfos[to->getId()].backwardCost;
+			if (cost > costBound) return; // not cheaper than the old path
+			if (cost < bestCost) {
+				bestCost = cost; meetFrom = from; meetTo = to;
 			}
+		};
 
-			if (isTarget && childRNode == connection.getSinkRNode()) {
-				targetRNode = childRNode;
-				childInfo.prev = rnode;
+		while (!rnodeQueue.empty() || !backwardQueue.empty()) {
+			double forwardKey = rnodeQueue.empty() ? inf : nodeInfos[rnodeQueue.top()->getId()].cost;
+			double backwardKey = backwardQueue.empty() ? inf : backwardQueue.top().first;
+			// every path not found yet crosses both frontiers, so it costs at least the larger of the two smallest keys
+			if (std::max(forwardKey, backwardKey) >= bestCost)
 				break;
+			nodesPoppedThisConnection ++;
+
+			// grow the side with fewer open nodes
+			if (backwardQueue.empty() || (!rnodeQueue.empty() && rnodeQueue.size() <= backwardQueue.size())) {
+				RouteNode* rnode = rnodeQueue.top(); rnodeQueue.pop();
+				double ninfo_partialCost = nodeInfos[rnode->getId()].partialCost;
+				RouteNode* const* children = sparse ? sparseChildren.data() + sparseOffsets[rnode->getId()] : rnode->getChildren().data();
+				int numChildren = sparse ? sparseOffsets[rnode->getId() + 1] - sparseOffsets[rnode->getId()] : rnode->getChildrenSize();
+				if (prefetchDistance > 0)
+					prefetchExpansion(children, numChildren, rnodeQueue.empty() ? nullptr : rnodeQueue.top());
+				for (int i = 0; i < numChildren; i ++) {
+					RouteNode* childRNode = children[i];
+					int lane = i % ChildBatch::capacity;
+					if (batchExpansion && lane == 0)
+						evaluateBatch(children, i, numChildren, ninfo_partialCost);
+					if (prefetchDistance > 0 && i + prefetchDistance < numChildren)
+						prefetch(children[i + prefetchDistance]);
+					NodeInfo& childInfo = nodeInfos[childRNode->getId()];
+					if (childInfo.isVisitedBackward == connectionUniqueId) {
+						meet(rnode, childRNode);
+						continue;
+					}
+					if (childInfo.isVisited == connectionUniqueId) continue;
+					bool inBBox = batchExpansion ? batch.inBBox[lane] : isAccessible(childRNode, connectionId);
+					if (!inBBox || !isAccessibleByType(childRNode, connection, false) || outsideCone(childRNode) || outsideCorridor(childRNode)) continue;
+
+					double newPartialPathCost;
+					double newTotalPathCost = batchExpansion ? evaluateLane(lane, childRNode, childInfo, ninfo_partialCost, false, newPartialPathCost)
+						: evaluate(childRNode, childInfo, ninfo_partialCost, false, newPartialPathCost);
+					if (exceedsBound(newTotalPathCost, newPartialPathCost)) continue;
+					push(childRNode, rnode, newTotalPathCost, newPartialPathCost, -1);
+				}
+			} else {
+				RouteNode* rnode = backwardQueue.top().second; backwardQueue.pop();
+				double backwardCost = nodeInfos[rnode->getId()].backwardCost;
+				int rnodeId = rnode->getId();
+				int parentEnd = parentOffsets[rnodeId + 1];
+				if (prefetchDistance > 0) {
+					for (int i = parentOffsets[rnodeId]; i < std::min(parentOffsets[rnodeId] + prefetchDistance, parentEnd); i ++)
+						prefetch(&rnodes[parentIds[i]]);
+				}
+				for (int i = parentOffsets[rnodeId]; i < parentEnd; i ++) {
+					if (prefetchDistance > 0 && i + prefetchDistance < parentEnd)
+						prefetch(&rnodes[parentIds[i + prefetchDistance]]);
+					RouteNode* parentRNode = &rnodes[parentIds[i]];
+					if (sparse && !inSparseGraph(parentRNode, rnode)) continue;
+					NodeInfo& parentInfo = nodeInfos[parentIds[i]];
+					if (parentInfo.isVisited == connectionUniqueId) {
+						meet(parentRNode, rnode);
+						continue;
+					}
+					if (parentInfo.isVisitedBackward == connectionUniqueId) continue;
+					if (!isAccessible(parentRNode, connectionId) || !isAccessibleByType(parentRNode, connection, false)) continue;
+					if (outsideCone(parentRNode) || outsideCorridor(parentRNode)) continue;
+
+					double sharingFactor;
+					double parentBackwardCost = backwardCost + nodePathCost(parentRNode, parentInfo, false, sharingFactor);
+					double totalCost = backwardTotalCost(parentRNode, parentBackwardCost, sharingFactor);
+					if (exceedsBound(totalCost, parentBackwardCost)) continue;
+					pushBackward(parentRNode, rnode, parentBackwardCost, totalCost);
+				}
 			}
+		}
 
-			if (!isAccessible(childRNode, connectionId)) {
-				continue; // Note: different from rwroute, the boundary nodes are included
+		if (meetFrom != nullptr) {
+			// turn the next links of the backward half into prev links, so that saveRouting walks the whole path from the sink
+			for (RouteNode *from = meetFrom, *to = meetTo; to != nullptr; from = to, to = nodeInfos[to->getId()].next) {
+				nodeInfos[to->getId()].prev = from;
+				targetRNode = to; // the backward half ends at the pin it started from
 			}
-				
-			switch (childRNode->getNodeType())
-			{
-			case WIRE:
-				if (!database.routingGraph.isAccessible(childRNode, connection)) {
+		}
+	} else {
+		while (!rnodeQueue.empty()) {
+			nodesPoppedThisConnection ++;
+			// int ninfoIdx = nodeInfoQueue.top(); nodeInfoQueue.pop();
+			RouteNode* rnode = rnodeQueue.top(); rnodeQueue.pop();
+			// THIS MAY BE A DANGLING REFERENCE!!!!!
+			NodeInfo& ninfo = nodeInfos[rnode->getId()];
+			// RouteNode* rnode = ninfo.cur;
+			double ninfo_partialCost = ninfo.partialCost;
+			assert_t(rnode != nullptr);
+
+			RouteNode* const* children = sparse ? sparseChildren.data() + sparseOffsets[rnode->getId()] : rnode->getChildren().data();
+			int numChildren = sparse ? sparseOffsets[rnode->getId() + 1] - sparseOffsets[rnode->getId()] : rnode->getChildrenSize();
+			if (prefetchDistance > 0)
+				prefetchExpansion(children, numChildren, rnodeQueue.empty() ? nullptr : rnodeQueue.top());
+			for (int i = 0; i < numChildren; i ++) {
+				RouteNode* childRNode = children[i];
+				int lane = i % ChildBatch::capacity;
+				if (batchExpansion && lane == 0)
+					evaluateBatch(children, i, numChildren, ninfo_partialCost);
+				if (prefetchDistance > 0 && i + prefetchDistance < numChildren)
+					prefetch(children[i + prefetchDistance]);
+				// childInfoIdx = nodeInfos.getIndex(childRNode);
+				NodeInfo& childInfo = nodeInfos[childRNode->getId()];
+				bool isVisited = (childInfo.isVisited == connectionUniqueId);
+				bool isTarget = (childInfo.isTarget == connectionUniqueId);
+
+				if (isVisited) {
 					continue;
 				}
-				break; // In rwroute, use UTurn by default
-			case PINBOUNCE:	
-                assert_t(!isTarget);
-                if (!isAccessiblePinbounce(childRNode, connection)) {
-                    continue;
-                }
-				break;
-			case PINFEED_I:
-                if (!isAccessiblePinfeedI(childRNode, connection, isTarget)) {
-                    continue;
-                }
-				break;
-			case LAGUNA_I:
-				continue; // never
-				break; 
-			case SUPER_LONG_LINE:
-				exit(0); // never
-				break;
-			default:
-				assert_t(false && "Unexpected rnode type");
-				break;
-			}
-			// evaluate cost and push
-			int countSourceUsesOrigin = net.countConnectionsOfUser(childRNode);
-			int countSourceUses = countSourceUsesOrigin;
-			int occChange = 0;
-			if (sync) {
-				countSourceUses = countSourceUses - net.getPreDecrementUser(childRNode) + net.getPreIncrementUser(childRNode);
-				occChange = childInfo.getOccChange(currentBatchStamp);
+
+				if (isTarget) { // the sink, or a pin it may be swapped to
+					targetRNode = childRNode;
+					childInfo.prev = rnode;
+					break;
+				}
+
+				bool inBBox = batchExpansion ? batch.inBBox[lane] : isAccessible(childRNode, connectionId);
+				if (!inBBox) {
+					continue; // Note: different from rwroute, the boundary nodes are included
+				}
+				if (!isAccessibleByType(childRNode, connection, isTarget)) {
+					continue;
+				}
+				if (outsideCone(childRNode) || outsideCorridor(childRNode)) {
+					continue;
+				}
+
+				// evaluate cost and push
+				double newPartialPathCost;
+				double newTotalPathCost = batchExpansion ? evaluateLane(lane, childRNode, childInfo, ninfo_partialCost, isTarget, newPartialPathCost)
+					: evaluate(childRNode, childInfo, ninfo_partialCost, isTarget, newPartialPathCost);
+				if (exceedsBound(newTotalPathCost, newPartialPathCost)) {
+					continue;
+				}
+				push(childRNode, rnode, newTotalPathCost, newPartialPathCost, -1);
 			}
-			double sharingFactor = 1 + sharingWeight * countSourceUses;
-			double nodeCost = getNodeCost(childRNode, connection, occChange, countSourceUses, countSourceUsesOrigin, sharingFactor, isTarget, tid);
-			assert_t(nodeCost >= 0);
-			// double newPartialPathCost = ninfo.partialCost + rnodeCostWeight * nodeCost + rnodeWLWeight * childRNode->getLength() / sharingFactor;
-			double newPartialPathCost = ninfo_partialCost + rnodeCostWeight * nodeCost + rnodeWLWeight * childRNode->getLength() / sharingFactor;
-
-			int childX = childRNode->getEndTileXCoordinate();
-	        int childY = childRNode->getEndTileYCoordinate();
-	        auto sinkRNode = connection.getSinkRNode();
-	        int sinkX = sinkRNode->getBeginTileXCoordinate();
-	        int sinkY = sinkRNode->getBeginTileYCoordinate();
-	        int deltaX = mkl_utils::scalar_abs(childX - sinkX);
-	        int deltaY = mkl_utils::scalar_abs(childY - sinkY);
-
-			double distanceToSink = deltaX + deltaY;
-	        double newTotalPathCost = newPartialPathCost + estWLWeight * distanceToSink / sharingFactor;
-			push(childRNode, rnode, newTotalPathCost, newPartialPathCost, -1);
-		}
-		if (targetRNode != nullptr)
-			break;
+			if (targetRNode != nullptr)
+				break;
+		}
 	}
 
-    // nodesPushed += nodesPoppedThisConnection + rnodeQueue.size();
-   	// nodesPopped += nodesPoppedThisConnection;
+	if constexpr (Trace) {
+		SearchTrace& trace = searchTraceForThreads[tid];
+		trace.nodesPopped += nodesPoppedThisConnection;
+		if (window != nullptr) {
+			if (targetRNode != nullptr) trace.repairs ++;
+		} else {
+			trace.connections ++;
+			if (targetRNode == nullptr) {
+				if (sparse) trace.sparseFallbacks ++;
+				else if (corridor) trace.corridorFallbacks ++;
+				else if (costBound < std::numeric_limits<double>::infinity()) trace.restoredPaths ++;
+				else trace.failures ++;
+			}
+		}
+		if (bidirectional) trace.bidirectional ++;
+		if (scratch.capacityBytes() > scratchBytes) trace.scratchGrowths ++;
+	}
 	if (targetRNode == nullptr) {
-		assert_t(rnodeQueue.empty());
+		assert_t(bidirectional || rnodeQueue.empty());
 		return false;
 	} 
+	if (window != nullptr)
+		return true; // the prev links lead from the sink-side end of the window to the source-side end
 	
+	if (targetRNode != sinkRNode) {
+		// a swapped LUT input (options.lutPinSwapping); the net follows in applyPinSwaps(), Netlist::write renames the pin
+		connection.swapSink(targetRNode);
+		if constexpr (Trace) searchTraceForThreads[tid].pinSwaps ++;
+	}
+
 	// update path, rnode occupancy and congestion cost
 	bool routed = saveRouting(connection, targetRNode, tid);
-	if (sync) {
+	if (routed)
+		indexPath(connectionId);
+	if constexpr (Sync) {
 		if (routed) {
 			// auto& net = database.nets[connection.getNetId()];
 			for (auto rnode: connection.getRNodes()) {
@@ -618,6 +1658,7 @@ bool aStarRoute::routeOneConnection(int connectionId, int tid, bool sync)
 		if (routed) {
 			// log() << "Connection " << connectionId << " routed" << endl;
 			connection.setRouted(routed);
+			connection.setNumNodesExplored(nodesPoppedThisConnection);
 			updateUsersAndPresentCongestionCost(connection);
 		} else {
 			connection.resetRoute();
@@ -627,8 +1668,216 @@ bool aStarRoute::routeOneConnection(int connectionId, int tid, bool sync)
 	return routed;
 }
 
+/**
+ * @brief Rip up and reroute a connection outside of the synchronized batches.
+ * With options.partialRipup, a routed connection first tries to repair only its congested window.
+ * 
+ * @param connectionId 
+ * @param tid The ID of the executing thread.
+ * @param fromNetTree Whether a full reroute starts from the net's routed tree (options.multiSource)
+ * @return true if the connection is routed
+ */
+bool aStarRoute::rerouteConnection(int connectionId, int tid, bool fromNetTree)
+{
+	auto& connection = database.indirectConnections[connectionId];
+	vector<RouteNode*>& oldPath = scratchForThreads[tid].oldPath;
+	bool bounded = options.costBound && connection.getRouted();
+	if (bounded)
+		oldPath.assign(connection.getRNodes().begin(), connection.getRNodes().end());
+	if (options.partialRipup && connection.getRouted() && repairConnection(connectionId, tid))
+		return true;
+	ripup(connection, false);
+	if (!bounded)
+		return routeOneConnection(connectionId, tid, false, fromNetTree);
+
+	// the old path is still a route of the connection; a new one is only worth searching for if it is cheaper at the current prices
+	double costBound = getPathCost(connection, oldPath, 0, oldPath.size() - 1) * (1 + options.costBoundSlack);
+	if (!routeOneConnection(connectionId, tid, false, fromNetTree, costBound))
+		restorePath(connectionId, oldPath);
+	return true;
+}
+
+/**
+ * @brief Get the cost of a part of a ripped-up path at the current prices (options.costBound):
+ * the partial cost A* gives the node before the sink-side end, where the search stops. Neither end is costed.
+ * 
+ * @param connection 
+ * @param path sink -> source
+ * @param to the sink-side end in path
+ * @param from the source-side end in path
+ */
+double aStarRoute::getPathCost(const Connection& connection, const vector<RouteNode*>& path, int to, int from)
+{
+	auto& net = database.nets[connection.getNetId()];
+	const BiasTerms bias = getBiasTerms(connection);
+	double cost = 0;
+	for (int i = from - 1; i > to; i --) {
+		RouteNode* rnode = path[i];
+		int countSourceUses = net.countConnectionsOfUser(rnode);
+		double sharingFactor = 1 + sharingWeight * countSourceUses;
+		double nodeCost = getNodeCost<false>(rnode, bias, 0, countSourceUses, countSourceUses, sharingFactor, false);
+		cost += rnodeCostWeight * nodeCost + rnodeWLWeight * rnode->getLength() / sharingFactor;
+	}
+	return cost;
+}
+
+/**
+ * @brief Route a ripped-up connection on a known path again, as saveRouting() and the end of the A* kernel do.
+ * 
+ * @param connectionId 
+ * @param path sink -> source
+ */
+void aStarRoute::restorePath(int connectionId, const vector<RouteNode*>& path)
+{
+	auto& connection = database.indirectConnections[connectionId];
+	for (RouteNode* rnode : path)
+		connection.addRNode(rnode);
+	indexPath(connectionId);
+	connection.setRouted(true);
+	updateUsersAndPresentCongestionCost(connection);
+}
+
+/**
+ * @brief Reroute only the congested window of a routed connection (options.partialRipup).
+ * The nodes from the first to the last overused one, widened by repairWindowPad nodes on each side, are ripped up
+ * and searched again between the two kept nodes around them. The search does not enter the kept prefix and suffix.
+ * 
+ * @param connectionId 
+ * @param tid The ID of the executing thread.
+ * @return false if the window cannot be repaired. The connection then holds the nodes it still uses, ready for a full ripup.
+ */
+bool aStarRoute::repairConnection(int connectionId, int tid)
+{
+	auto& connection = database.indirectConnections[connectionId];
+	auto& net = database.nets[connection.getNetId()];
+	auto& nodeInfos = nodeInfosForThreads[tid];
+	SearchScratch& scratch = scratchForThreads[tid];
+	vector<RouteNode*>& path = scratch.path;
+	path.assign(connection.getRNodes().begin(), connection.getRNodes().end()); // sink -> source
+	int pathSize = path.size();
+
+	int firstOverused = -1;
+	int lastOverused = -1;
+	for (int i = 0; i < pathSize; i ++) {
+		if (path[i]->isOverUsed()) {
+			if (firstOverused < 0) firstOverused = i;
+			lastOverused = i;
+		}
+	}
+	if (firstOverused < 0)
+		return false;
+	int to = std::max(firstOverused - repairWindowPad - 1, 0);            // kept node on the sink side
+	int from = std::min(lastOverused + repairWindowPad + 1, pathSize - 1); // kept node on the source side
+	if (path[to]->isOverUsed() || path[from]->isOverUsed() || (to == 0 && from == pathSize - 1))
+		return false; // nothing to keep
+
+	// rip up the window
+	unindexPath(connectionId);
+	for (int i = to + 1; i < from; i ++) {
+		if (net.decrementUser(path[i]))
+			path[i]->decrementOccupancy();
+		path[i]->updatePresentCongestionCost(presentCongestionFactor);
+	}
+	connection.resetRoute();
+	for (int i = 0; i <= to; i ++) connection.addRNode(path[i]);
+	for (int i = from; i < pathSize; i ++) connection.addRNode(path[i]);
+
+	// the old window bounds the new one as the old path bounds a full reroute
+	RepairWindow window{path, to, from};
+	double costBound = std::numeric_limits<double>::infinity();
+	if (options.costBound)
+		costBound = getPathCost(connection, path, to, from) * (1 + options.costBoundSlack);
+	if (!searchConnection(connectionId, tid, false, false, costBound, &window)) {
+		indexPath(connectionId);
+		return false;
+	}
+
+	// splice the new window between the kept nodes
+	RouteNode* fromRNode = path[from];
+	RouteNode* toRNode = path[to];
+	connection.resetRoute();
+	for (int i = 0; i <= to; i ++) connection.addRNode(path[i]);
+	for (RouteNode* rnode = nodeInfos[toRNode->getId()].prev; rnode != fromRNode; rnode = nodeInfos[rnode->getId()].prev) {
+		connection.addRNode(rnode);
+		if (net.incrementUser(rnode)) {
+			rnode->incrementOccupancy();
+			if (rnode->isOverUsed())
+				flagUsersOfNode(rnode);
+		}
+		rnode->updatePresentCongestionCost(presentCongestionFactor);
+	}
+	for (int i = from; i < pathSize; i ++) connection.addRNode(path[i]);
+	indexPath(connectionId);
+	connection.setRoutedThisIter(true);
+	incrementRoutedConnectionNum();
+	return true;
+}
+
+/**
+ * @brief Link a routed connection into the user lists of the nodes on its path, and flag it if one of them is overused.
+ * 
+ * @param connectionId 
+ */
+void aStarRoute::indexPath(int connectionId)
+{
+	const auto& rnodes = database.indirectConnections[connectionId].getRNodes();
+	auto& nextUsers = nextUserOfPath[connectionId];
+	assert_t(nextUsers.empty() && rnodes.size() < (1 << 16));
+	nextUsers.resize(rnodes.size());
+	bool congested = false;
+	for (int i = 0; i < rnodes.size(); i ++) {
+		int rnodeId = rnodes[i]->getId();
+		std::lock_guard<std::mutex> lock(nodeUserLocks[rnodeId % numNodeUserLocks]);
+		nextUsers[i] = firstUserOfNode[rnodeId];
+		firstUserOfNode[rnodeId] = userKey(connectionId, i);
+		congested |= rnodes[i]->isOverUsed();
+	}
+	if (congested)
+		congestedFlags[connectionId] = true;
+}
+
+/**
+ * @brief Unlink a connection from the user lists of the nodes on its path. It must be called before the path changes.
+ * 
+ * @param connectionId 
+ */
+void aStarRoute::unindexPath(int connectionId)
+{
+	const auto& rnodes = database.indirectConnections[connectionId].getRNodes();
+	auto& nextUsers = nextUserOfPath[connectionId];
+	if (nextUsers.empty())
+		return; // not routed
+	assert_t(nextUsers.size() == rnodes.size());
+	for (int i = 0; i < rnodes.size(); i ++) {
+		int rnodeId = rnodes[i]->getId();
+		long long key = userKey(connectionId, i);
+		std::lock_guard<std::mutex> lock(nodeUserLocks[rnodeId % numNodeUserLocks]);
+		long long* link = &firstUserOfNode[rnodeId];
+		while (*link != key) {
+			assert_t(*link >= 0);
+			link = &nextUserOfPath[*link >> 16][*link & 0xffff];
+		}
+		*link = nextUsers[i];
+	}
+	nextUsers.clear();
+}
+
+/**
+ * @brief Flag the connections using a node, after the node became overused.
+ * 
+ * @param rnode 
+ */
+void aStarRoute::flagUsersOfNode(RouteNode* rnode)
+{
+	int rnodeId = rnode->getId();
+	std::lock_guard<std::mutex> lock(nodeUserLocks[rnodeId % numNodeUserLocks]);
+	for (long long user = firstUserOfNode[rnodeId]; user >= 0; user = nextUserOfPath[user >> 16][user & 0xffff])
+		congestedFlags[user >> 16] = true;
+}
+
 /**
  * @brief Check if the connection need to be (re-)routed.
+ * Only the paths of the connections in congestedFlags are checked for overused nodes.
  * 
  * @param connection 
  * @return true if the connection is congested or not routed yet,
@@ -636,7 +1885,7 @@ bool aStarRoute::routeOneConnection(int connectionId, int tid, bool sync)
  */
 bool aStarRoute::shouldRoute(const Connection& connection)
 {
-	return !connection.getRouted() || connection.isCongested();
+	return !connection.getRouted() || (congestedFlags[connection.getId()] && connection.isCongested());
 }
 
 /**
@@ -654,44 +1903,62 @@ bool aStarRoute::isAccessible(const RouteNode* rnode, int connectionId)
 	       rnode->getEndTileYCoordinate() > conn.getYMinBB() && rnode->getEndTileYCoordinate() < conn.getYMaxBB(); 
 }
 
+/**
+ * @brief Get the terms of the bias cost that depend only on the net of the connection.
+ * 
+ * @param connection The connection to be routed.
+ * @return BiasTerms 
+ */
+aStarRoute::BiasTerms aStarRoute::getBiasTerms(const Connection& connection)
+{
+	auto& net = database.nets[connection.getNetId()];
+	BiasTerms bias;
+	bias.scale = 1.0 / net.getConnectionSize() / net.getDoubleHpwl();
+	bias.xCenter = net.getXCenter();
+	bias.yCenter = net.getYCenter();
+	return bias;
+}
+
 /**
  * @brief Get the cost of the node.
+ * The congestion part of a node without users of the same net is the cached RouteNode::getCongestionCost(),
+ * which the node keeps current when its congestion costs change.
  * 
  * @param rnode The node.
- * @param connection The connection to be routed.
+ * @param bias The bias terms of the connection to be routed.
  * @param occChange (In stable-first routing) the uncommitted change in the node's occupancy
  * @param countSourceUses The number of connections from the same net using this node 
  * @param countSourceUsesOrigin (In stable-first routing) The number of connections from the same net using this node at the last synchorization barrier
  * @param sharingFactor The sharing factor.
  * @param isTarget Whether this node is the sink node of this connection
- * @param tid The ID of the executing thread.
+ * @tparam Sync Whether occChange and countSourceUsesOrigin carry uncommitted changes. Otherwise they are 0 and countSourceUses.
  * @return double The cost of this node.
  */
-double aStarRoute::getNodeCost(RouteNode* rnode, const Connection& connection, int occChange, int countSourceUses, int countSourceUsesOrigin, double sharingFactor, bool isTarget, int tid)
+template <bool Sync>
+double aStarRoute::getNodeCost(RouteNode* rnode, const BiasTerms& bias, int occChange, int countSourceUses, int countSourceUsesOrigin, double sharingFactor, bool isTarget)
 {
-	bool hasSameSourceUsers = (countSourceUses != 0);
-	double presentCongestionCost;
-	auto& net = database.nets[connection.getNetId()];
 	assert_t(countSourceUses >= 0);
-	int preDecOcc = ((countSourceUsesOrigin > 0) && (countSourceUses == 0)) ? 1 : 0;
-	int preIncOcc = ((countSourceUsesOrigin == 0) && (countSourceUses > 0)) ? 1 : 0;
-
-	if (hasSameSourceUsers) { // the rnode is used by other connection(s) from the same net
-		int overOccupancy = rnode->getOccupancy() - preDecOcc + preIncOcc + occChange - rnode->getCapacity();
-		// int overOccupancy = rnode->getOccupancy() - preDecOcc + preIncOcc - rnode->getCapacity();
-		// make the congestion cost less for the current connection
-		presentCongestionCost = 1 + overOccupancy * presentCongestionFactor;
-	} else {
-		presentCongestionCost = rnode->getPresentCongestionCost();
-	}
 
 	double biasCost = 0;
-    if (!isTarget) {
-        auto& net = database.nets[connection.getNetId()];
-        biasCost = rnode->getBaseCost() / net.getConnectionSize() *
-                (mkl_utils::scalar_fabs(rnode->getEndTileXCoordinate() - net.getXCenter()) + mkl_utils::scalar_fabs(rnode->getEndTileYCoordinate() - net.getYCenter())) / net.getDoubleHpwl();
-    }
+	if (!isTarget) {
+		biasCost = rnode->getBaseCost() * bias.scale *
+			(mkl_utils::scalar_fabs(rnode->getEndTileXCoordinate() - bias.xCenter) + mkl_utils::scalar_fabs(rnode->getEndTileYCoordinate() - bias.yCenter));
+	}
+
+	if (countSourceUses == 0) {
+		// no user of the same net: the cached congestion cost applies as is, and the sharing factor is 1
+		return rnode->getCongestionCost() + biasCost;
+	}
 
+	// the rnode is used by other connection(s) from the same net
+	int overOccupancy = rnode->getOccupancy() - rnode->getCapacity();
+	if constexpr (Sync) {
+		// a user of the same net that is not committed yet still occupies the node (a pre-decrement cannot apply here, since countSourceUses > 0)
+		int preIncOcc = (countSourceUsesOrigin == 0) ? 1 : 0;
+		overOccupancy += preIncOcc + occChange;
+	}
+	// make the congestion cost less for the current connection
+	double presentCongestionCost = 1 + overOccupancy * presentCongestionFactor;
 	return rnode->getBaseCost() * rnode->getHistoricalCongestionCost() * presentCongestionCost / sharingFactor + biasCost;
 }
 
@@ -732,8 +1999,11 @@ void aStarRoute::updateUsersAndPresentCongestionCost(Connection& connection)
 {
 	for (auto rnode : connection.getRNodes()) {
 		bool newlyAdd = database.nets[connection.getNetId()].incrementUser(rnode);
-		if (newlyAdd)
+		if (newlyAdd) {
 			rnode->incrementOccupancy();
+			if (rnode->isOverUsed())
+				flagUsersOfNode(rnode);
+		}
 		rnode->updatePresentCongestionCost(presentCongestionFactor);
 	}
 }
@@ -752,10 +2022,12 @@ void aStarRoute::dynamicCostFactorUpdating(bool isCongestedDesign)
 		presentCongestionMultiplier = 1.1 * (1 + r2);
 	}
 
-	presentCongestionFactor *= presentCongestionMultiplier;
+	presentCongestionFactor *= presentCongestionMultiplier * budgetBoost;
 	presentCongestionFactor = std::min(presentCongestionFactor, maxPresentCongestionFactor);
 
 	numOverUsedRNodes.store(0);
+	for (auto& flag : congestedFlags)
+		flag.store(false, std::memory_order_relaxed);
 
 	std::function<void(int tid)> update = [&](int tid) {
 		for (int rnodeId = tid; rnodeId < database.numNodes; rnodeId += numThread) {
@@ -767,7 +2039,8 @@ void aStarRoute::dynamicCostFactorUpdating(bool isCongestedDesign)
 				// overUsedRNodeIds.emplace_back(rnode.getId());
 				numOverUsedRNodes++;
 				rnode.setPresentCongestionCost(1 + (overuse + 1) * presentCongestionFactor);
-				rnode.setHistoricalCongestionCost(rnode.getHistoricalCongestionCost() + overuse * historicalCongestionFactor);
+				rnode.setHistoricalCongestionCost(rnode.getHistoricalCongestionCost() + overuse * historicalCongestionFactor * budgetBoost);
+				flagUsersOfNode(&rnode);
 			}
 		}
 	};
@@ -790,30 +2063,62 @@ void aStarRoute::dynamicCostFactorUpdating(bool isCongestedDesign)
 void aStarRoute::ripup(Connection& connection, bool sync)
 {
 	// mutex.lock();
-	auto rnodes = connection.getRNodes();
-	if (rnodes.size() == 0) {
-		assert_t(!connection.getRouted());
-		rnodes.emplace_back(connection.getSinkRNode());
-	}
-	if (!sync) {
-		for (auto rnode : rnodes) {
-			bool isErased = database.nets[connection.getNetId()].decrementUser(rnode);
+	auto& net = database.nets[connection.getNetId()];
+	auto release = [&](RouteNode* rnode) {
+		if (!sync) {
+			bool isErased = net.decrementUser(rnode);
 			if (isErased)
 				rnode->decrementOccupancy();
 			rnode->updatePresentCongestionCost(presentCongestionFactor);
-		}
-	} else {
-		auto& net = database.nets[connection.getNetId()];
-		for (auto rnode : rnodes) {
+		} else {
 			net.preDecrementUser(rnode);
 		}
+	};
+	const auto& rnodes = connection.getRNodes();
+	if (rnodes.size() == 0) {
+		// an unrouted connection still holds its sink (updateSinkNodeUsage)
+		assert_t(!connection.getRouted());
+		release(connection.getSinkRNode());
 	}
+	for (auto rnode : rnodes)
+		release(rnode);
 	
+	unindexPath(connection.getId());
 	connection.resetRoute();
 	connection.setRouted(false);
 	// mutex.unlock();
 }
 
+/**
+ * @brief Check the access rules of a node reached by this connection, other than the bounding box
+ * 
+ * @param rnode 
+ * @param connection 
+ * @param isTarget Whether this node is the sink node of this connection
+ * @return true if the connection may use this node
+ */
+bool aStarRoute::isAccessibleByType(RouteNode* rnode, const Connection& connection, bool isTarget)
+{
+	switch (rnode->getNodeType())
+	{
+	case WIRE:
+		return database.routingGraph.isAccessible(rnode, connection); // In rwroute, use UTurn by default
+	case PINBOUNCE:	
+		assert_t(!isTarget);
+		return isAccessiblePinbounce(rnode, connection);
+	case PINFEED_I:
+		return isAccessiblePinfeedI(rnode, connection, isTarget);
+	case LAGUNA_I:
+		return false; // never
+	case SUPER_LONG_LINE:
+		return false; // never
+	default:
+		assert_t(false && "Unexpected rnode type");
+		break;
+	}
+	return true;
+}
+
 bool aStarRoute::isAccessiblePinbounce(const RouteNode* child, const Connection& connection)
 {
     return database.routingGraph.isAccessible(child, connection);
@@ -843,20 +2148,20 @@ void aStarRoute::routePartitionTree(PartitionTree* tree)
 {
 	for (auto& treeNodes : tree->scheduledTreeNodes) {
 		if (treeNodes.size() == 0) continue;
-		auto runRoute = [this, &treeNodes](int i) {
-			routePartitionTreeLeafNode(treeNodes[i]);
+		auto runRoute = [this, &treeNodes](int i, int tid) {
+			routePartitionTreeLeafNode(treeNodes[i], tid);
 		};
 		runJobsMT(treeNodes.size(), numThread, runRoute);
 	}
 }
 
-void aStarRoute::routePartitionTreeLeafNode(PartitionTreeNode* node)
+void aStarRoute::routePartitionTreeLeafNode(PartitionTreeNode* node, int tid)
 {
 	for (int connectionId : node->connectionIds) {
 		auto& connection = database.indirectConnections[connectionId];
 		if (shouldRoute(connection)) {
-			ripup(connection, false);
-			bool success = routeOneConnection(connectionId, 0, false);
+			// leaf nodes route in parallel and may split a net, so the other connections' paths can change under us
+			bool success = rerouteConnection(connectionId, tid, false);
 			if (!success) {
 				// mutex.lock();
 				// failRouteNum ++;
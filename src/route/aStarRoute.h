@@ -3,14 +3,20 @@
 #include "db/database.h"
 #include "db/routeNode.h"
 #include "partitionTree.h"
+#include "routeOptions.h"
+#include "checkpoint.h"
+#include "searchScratch.h"
+#include "reachCone.h"
+#include "globalRouter.h"
 #include <queue>
 #include <mutex>
 #include <future>
 #include <atomic>
+#include <limits>
 
 class aStarRoute {
 public:
-	aStarRoute(Database& database_, bool isRuntimeFirst_) : database(database_), isRuntimeFirst(isRuntimeFirst_) {
+	aStarRoute(Database& database_, const RouteOptions& options_) : database(database_), options(options_), isRuntimeFirst(options_.isRuntimeFirst) {
 		numThread = database.getNumThread();
 		scheduledTreeNodes.resize(100); // initialize with a large size.
 		nodeInfosForThreads.resize(numThread);
@@ -52,14 +58,24 @@ public:
 		// 	nodeInfos.resize(database.numNodes);
 		// }
 		netIdsForThreads.resize(numThread);
+		searchTraceForThreads.resize(numThread);
+		scratchForThreads.resize(numThread);
+		reachCones.setCapacity((size_t)options.reachConeMB << 20);
 		numOverUsedRNodes.store(0);
+		firstUserOfNode.assign(database.numNodes, -1);
+		nextUserOfPath.resize(database.numConns);
+		congestedFlags = vector<std::atomic<bool>>(database.numConns);
+		nodeUserLocks = vector<std::mutex>(numNodeUserLocks);
+		utils::huge_pages::report();
 	}
-	void route();
-	bool routeOneConnection(int connectionId, int tid, bool sync);
+	bool route();
+	bool routeOneConnection(int connectionId, int tid, bool sync, bool fromNetTree, double costBound = std::numeric_limits<double>::infinity());
 	vector<RouteResult> nodeRoutingResults;
 
 private:
 	// parameters
+	Database& database;
+	RouteOptions options;
 	bool isRuntimeFirst = false;
 	int iter = 0;
 	int maxIter = 500;
@@ -73,23 +89,27 @@ private:
 	int xMargin = 3;
 	int yMargin = 15;
 
-	int nodesPushed = 0;
-	int nodesPopped = 0;
-	int expandChildrenNum = 0;
+	// adaptive bounding boxes (options.adaptiveBBox) ->
+	int adaptiveXMarginStart = 2; // tight start, most connections do not need more
+	int adaptiveYMarginStart = 6;
+	int adaptiveXMarginMax = 12;
+	int adaptiveYMarginMax = 60;
+	bool isPartitionTreeStale = false; // a bounding box changed after the RPTT was built
+	// adaptive bounding boxes <-
 
 	std::atomic<int> routedConnectionNum;
 	std::atomic<int> failRouteNum;
 	int connectionIdBase = 0;
 	float presentCongestionFactor = 0.5;
 	float historicalCongestionFactor = 1;
+	float budgetBoost = 1; // extra growth of the congestion factors when the time budget is about to be missed
 	double rnodeCostWeight = 1;
 	double sharingWeight = 1;
 	double rnodeWLWeight = 0.2;
 	double estWLWeight = 0.8;
-	Database& database;
 	std::vector<int> sortedConnectionIds;
 	std::atomic<int> numOverUsedRNodes;
-	PartitionTree* partitionTree;
+	PartitionTree* partitionTree = nullptr;
 	vector<vector<PartitionTreeNode*>> scheduledTreeNodes; // partitionTree leaf nodes in the same vector can be routed in parallel
 	int scheduledLevel;
 	std::unordered_map<PartitionTreeNode*, int> treeNodeLevelMap; // partitionTree leaf nodes in the same vector can be routed in parallel
@@ -111,8 +131,8 @@ private:
 
 	vector<vector<vector<int>>> netIdBatchesForThreads; // netIdBatchesForThreads[batchId][tid][]
 	vector<vector<int>> netIdsForThreads;
-	vector<vector<NodeInfo>> nodeInfosForThreads;
-	vector<vector<int>> occChangeForThreads;
+	vector<utils::huge_vector<NodeInfo>> nodeInfosForThreads;
+	vector<utils::huge_vector<int>> occChangeForThreads;
 
 	// region-based partitioning ->
 	PartitionBBox device;
@@ -129,28 +149,166 @@ private:
 
 	// overlap routing related <-
 
+	// search trace (options.traceSearch) ->
+	struct SearchTrace {
+		long long nodesPushed = 0;
+		long long nodesPopped = 0;
+		int connections = 0;
+		int failures = 0;
+		int bidirectional = 0;
+		int repairs = 0;
+		int scratchGrowths = 0; // searches that had to grow a scratch buffer
+		int coneSearches = 0;   // searches pruned by a reverse-reachability cone
+		int sparseFallbacks = 0; // sparse searches without a path, searched again on the full graph
+		int boundedSearches = 0;
+		int restoredPaths = 0;   // bounded searches that found nothing cheaper than the old path
+		long long boundPruned = 0;
+		int netTrees = 0;        // nets ripped up and routed again as a whole
+		long long conePruned = 0;
+		int corridorSearches = 0;  // searches kept inside the corridor of their connection
+		int corridorFallbacks = 0; // corridor searches without a path, searched again on the whole graph
+		long long corridorPruned = 0;
+		int pinSwaps = 0;        // searches that ended at another pin than the previous sink (options.lutPinSwapping)
+	};
+	vector<SearchTrace> searchTraceForThreads;
+	void logSearchTrace();
+	// search trace <-
+
+	vector<SearchScratch> scratchForThreads; // reusable buffers of the searches
+
+	// heuristic weight schedule (options.heuristicWeightStart, options.adaptiveHeuristic) ->
+	double scheduledEstWLWeight = 0.8;  // estWLWeight of this iteration
+	int peakOverusedNodeNum = 0;
+	double heuristicExploreBudget = 50; // nodes popped per tile of HPWL before the weight of a connection is raised
+	double heuristicMaxBoost = 2;
+	void updateHeuristicWeight();
+	double getEstWLWeight(const Connection& connection);
+	// heuristic weight schedule <-
+
+	// bidirectional search (options.bidirectionalHpwl) ->
+	vector<int> parentOffsets; // reverse routing graph in CSR form: the parents of node i are parentIds[parentOffsets[i] .. parentOffsets[i + 1])
+	vector<int> parentIds;
+	std::once_flag parentsBuilt; // built by the first search that needs it
+	void buildParents();
+	bool isBidirectional(const Connection& connection);
+	// bidirectional search <-
+
+	// sparse first iterations (options.sparseIterations) ->
+	int sparseChildrenPerGroup = 2;  // wire children kept per direction and length
+	vector<int> sparseOffsets;       // sparse graph in CSR form: the children of node i are sparseChildren[sparseOffsets[i] .. sparseOffsets[i + 1])
+	vector<RouteNode*> sparseChildren;
+	bool sparsePass = false;         // this iteration searches the sparse graph first
+	void buildSparseGraph();
+	// sparse first iterations <-
+
+	// global routing corridors (options.corridorIterations) ->
+	GlobalRouter globalRouter;
+	bool corridorPass = false;       // this iteration searches the corridors of the connections first
+	void planCorridors();
+	// global routing corridors <-
+
+	// reverse-reachability cones (options.reachConeMB) ->
+	ReachConeCache reachCones;
+	std::atomic<int> coneBuilds{0}; // each cone search labels NodeInfo::isVisitedBackward with its own negative number
+	std::shared_ptr<const ReachCone> getReachCone(int connectionId, int tid);
+	// reverse-reachability cones <-
+
+	// net trees (options.netTreeFanout) ->
+	vector<vector<int>> netTreeOrders; // the connections of a net routed as a tree in routing order, empty for the other nets
+	void buildNetTreeOrders();
+	int routeNetTree(int netId, int tid);
+	// net trees <-
+
+	// cost bound from the old path (options.costBound) ->
+	double getPathCost(const Connection& connection, const vector<RouteNode*>& path, int to, int from);
+	void restorePath(int connectionId, const vector<RouteNode*>& path);
+	// cost bound <-
+
+	// partial rip-up (options.partialRipup) ->
+	int repairWindowPad = 2; // uncongested nodes ripped up with the overused ones on each side, room for the detour
+	// the part of a routed path (sink -> source) searched again between its kept ends path[to] and path[from]
+	struct RepairWindow {
+		const vector<RouteNode*>& path;
+		int to;
+		int from;
+	};
+	bool rerouteConnection(int connectionId, int tid, bool fromNetTree);
+	bool repairConnection(int connectionId, int tid);
+	// partial rip-up <-
+
+	// congestion index ->
+	// A routed connection is linked into the user lists of the nodes on its path, so that the connections on an overused node are found from the node.
+	// congestedFlags holds a superset of the congested connections: a flag is set when a path is indexed over an overused node or a node of the path
+	// becomes overused, and all flags are rebuilt from the overused nodes after every iteration. shouldRoute only checks the paths of flagged connections.
+	utils::huge_vector<long long> firstUserOfNode; // userKey of the first user, -1: none
+	vector<vector<long long>> nextUserOfPath;      // nextUserOfPath[connectionId][i]: the user after this connection in the list of its i-th node
+	vector<std::atomic<bool>> congestedFlags;
+	int numNodeUserLocks = 4096;
+	vector<std::mutex> nodeUserLocks;              // striped by node id, guard the user lists
+	static long long userKey(int connectionId, int position) { return ((long long)connectionId << 16) | position; }
+	void indexPath(int connectionId);
+	void unindexPath(int connectionId);
+	void flagUsersOfNode(RouteNode* rnode);
+	// congestion index <-
+
+	// time budget ->
+	utils::timer routeTimer;
+	double budgetReserveRatio = 0.05; // part of the budget reserved for direct routing and saving the solution
+	RouteCheckpoint legalSolution;    // the paths of the last iteration without overuse and with the fewest failed connections
+	int legalFailures = -1;           // failed connections of legalSolution, -1: none kept
+	// time budget <-
+
+	// checkpoint & resume ->
+	std::thread checkpointWriter;
+	std::atomic<bool> isWritingCheckpoint{false};
+	// checkpoint & resume <-
+
+	// connection-specific terms of the bias cost, fixed during one search
+	struct BiasTerms {
+		double scale = 0; // 1 / (connections of the net * double HPWL of the net)
+		double xCenter = 0;
+		double yCenter = 0;
+	};
+	BiasTerms getBiasTerms(const Connection& connection);
+
 	void sortConnections();
+	bool searchConnection(int connectionId, int tid, bool sync, bool fromNetTree, double costBound, const RepairWindow* window);
+	template <bool Sync, bool Trace>
+	bool routeOneConnectionKernel(int connectionId, int tid, bool fromNetTree, bool sparse, bool corridor, double costBound, const RepairWindow* window);
 	bool shouldRoute(const Connection& connection);
 	void ripup(Connection& connection, bool sync);
 	bool isAccessible(const RouteNode* rnode, int connectionId);
-	double getNodeCost(RouteNode* rnode, const Connection& connection, int occChange, int countSourceUses, int countSourceUsesOrigin, double sharingFactor, bool isTarget, int tid);
+	template <bool Sync>
+	double getNodeCost(RouteNode* rnode, const BiasTerms& bias, int occChange, int countSourceUses, int countSourceUsesOrigin, double sharingFactor, bool isTarget);
 	bool saveRouting(Connection& connection, RouteNode* rnode, int tid);
 	void updateUsersAndPresentCongestionCost(Connection& connection);
 	void dynamicCostFactorUpdating(bool isCongestedDesign);
+	bool isAccessibleByType(RouteNode* rnode, const Connection& connection, bool isTarget);
     bool isAccessiblePinbounce(const RouteNode* child, const Connection& connection);
     bool isAccessiblePinfeedI(RouteNode* child, const Connection& connection, bool isTarget);
 
 	void updateSinkNodeUsage();
 
 	void routePartitionTree(PartitionTree* tree);
-	void routePartitionTreeLeafNode(PartitionTreeNode* node);
+	void routePartitionTreeLeafNode(PartitionTreeNode* node, int tid);
 
-	void routeIndirectConnections();
+	bool routeIndirectConnections();
+	bool updateTimeBudget(double avgIterTime, int overusedNodeNum, int decreaseOfCongestedNodes);
 	void routeDirectConnections();
 	void saveAllRoutingSolutions();
 	void fixNetRoutes(const Net& net, std::set<RouteNode*>& netRNodes);
 
-	void updateIndirectConnectionBBox(int x_margin, int y_margin);
+	void updateIndirectConnectionBBox();
+	bool updateAdaptiveMargins();
+	void buildPartitionTree();
+
+	// checkpoint & resume ->
+	void saveCheckpoint(RouteCheckpoint* checkpoint);
+	bool restoreCheckpoint(RouteCheckpoint& checkpoint);
+	void restorePaths(const RouteCheckpoint& checkpoint);
+	void applyPinSwaps();
+	void waitForCheckpointWriter();
+	// checkpoint & resume <-
 
 	// overlap routing related ->
 	void regionBasedPartition();
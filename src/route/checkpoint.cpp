@@ -0,0 +1,151 @@
+#include "checkpoint.h"
+#include <fstream>
+#include <filesystem>
+
+/**
+ * @brief FNV-1a hash over the source/sink pairs of all connections, with the sinks of the placed netlist
+ *
+ */
+uint64_t RouteCheckpoint::hashConnections(const vector<Connection>& connections)
+{
+	uint64_t hash = 1469598103934665603ULL;
+	auto mix = [&hash](uint64_t v) {
+		hash ^= v;
+		hash *= 1099511628211ULL;
+	};
+	for (const auto& conn : connections) {
+		mix(conn.getSource());
+		mix(conn.getPlacedSink());
+	}
+	return hash;
+}
+
+/**
+ * @brief Record the nodes whose occupancy or congestion costs are not at their initial values
+ *
+ */
+void RouteCheckpoint::captureNodes(const utils::huge_vector<RouteNode>& routeNodes)
+{
+	nodeIds.clear();
+	occupancies.clear();
+	presentCosts.clear();
+	historicalCosts.clear();
+	for (const RouteNode& rnode : routeNodes) {
+		int occ = rnode.getOccupancy();
+		float pres = rnode.getPresentCongestionCost();
+		float hist = rnode.getHistoricalCongestionCost();
+		if (occ == 0 && pres == 1 && hist == 1)
+			continue;
+		nodeIds.emplace_back(rnode.getId());
+		occupancies.emplace_back(occ);
+		presentCosts.emplace_back(pres);
+		historicalCosts.emplace_back(hist);
+	}
+}
+
+void RouteCheckpoint::captureConnections(const vector<Connection>& connections)
+{
+	routed.resize(connections.size());
+	pathOffsets.resize(connections.size() + 1);
+	xMargins.resize(connections.size());
+	yMargins.resize(connections.size());
+	bboxStreaks.resize(connections.size());
+	sinks.resize(connections.size());
+	pathOffsets[0] = 0;
+	for (int i = 0; i < connections.size(); i ++) {
+		routed[i] = connections[i].getRouted();
+		pathOffsets[i + 1] = pathOffsets[i] + connections[i].getRNodeSize();
+		xMargins[i] = connections[i].getXMargin();
+		yMargins[i] = connections[i].getYMargin();
+		bboxStreaks[i] = connections[i].getBBoxStreak();
+		sinks[i] = connections[i].getSink();
+	}
+	pathNodes.resize(pathOffsets.back());
+	for (int i = 0; i < connections.size(); i ++) {
+		uint32_t offset = pathOffsets[i];
+		for (RouteNode* rnode : connections[i].getRNodes())
+			pathNodes[offset ++] = rnode->getId();
+	}
+}
+
+/**
+ * @brief Write the checkpoint to a temporary file and rename it, so that a crash during writing never destroys the previous checkpoint
+ *
+ */
+bool RouteCheckpoint::save(const string& fileName) const
+{
+	string tmpName = fileName + ".tmp";
+	{
+		std::ofstream ofs(tmpName, std::ios::binary);
+		if (!ofs) {
+			log(LOG_ERROR) << "Cannot open checkpoint file " << tmpName << endl;
+			return false;
+		}
+		boost::archive::binary_oarchive oa(ofs);
+		int ver = version;
+		oa & ver;
+		oa & *this;
+		if (!ofs) {
+			log(LOG_ERROR) << "Failed to write checkpoint file " << tmpName << endl;
+			return false;
+		}
+	}
+	std::error_code ec;
+	std::filesystem::rename(tmpName, fileName, ec);
+	if (ec) {
+		log(LOG_ERROR) << "Failed to move checkpoint " << tmpName << " to " << fileName << ": " << ec.message() << endl;
+		return false;
+	}
+	return true;
+}
+
+bool RouteCheckpoint::load(const string& fileName)
+{
+	std::ifstream ifs(fileName, std::ios::binary);
+	if (!ifs)
+		return false;
+	try {
+		boost::archive::binary_iarchive ia(ifs);
+		int ver = -1;
+		ia & ver;
+		if (ver != version) {
+			log(LOG_ERROR) << "Checkpoint " << fileName << " has version " << ver << ", expected " << version << endl;
+			return false;
+		}
+		ia & *this;
+	} catch (const std::exception& e) {
+		log(LOG_ERROR) << "Failed to read checkpoint " << fileName << ": " << e.what() << endl;
+		return false;
+	}
+	if (!isConsistent()) {
+		log(LOG_ERROR) << "Checkpoint " << fileName << " is corrupted" << endl;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Check the loaded arrays against each other and against numNodes, so that a truncated or foreign file that still
+ * deserializes is rejected before restoreCheckpoint indexes the routing graph with it
+ *
+ */
+bool RouteCheckpoint::isConsistent() const
+{
+	if (numNodes < 0 || numConns < 0)
+		return false;
+	if (occupancies.size() != nodeIds.size() || presentCosts.size() != nodeIds.size() || historicalCosts.size() != nodeIds.size())
+		return false;
+	if (xMargins.size() != numConns || yMargins.size() != numConns || bboxStreaks.size() != numConns || sinks.size() != numConns)
+		return false;
+	if (routed.size() != numConns || pathOffsets.size() != numConns + 1 || pathOffsets[0] != 0 || pathOffsets.back() != pathNodes.size())
+		return false;
+	for (int i = 0; i < numConns; i ++)
+		if (pathOffsets[i] > pathOffsets[i + 1]) return false;
+	for (obj_idx id : nodeIds)
+		if (id >= (obj_idx)numNodes) return false;
+	for (obj_idx id : pathNodes)
+		if (id >= (obj_idx)numNodes) return false;
+	for (obj_idx id : sinks)
+		if (id >= (obj_idx)numNodes) return false;
+	return true;
+}
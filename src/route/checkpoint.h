@@ -0,0 +1,104 @@
+#pragma once
+#include "global.h"
+#include "db/connection.h"
+#include "db/routeNode.h"
+#include "utils/hugePage.h"
+
+/**
+ * @brief A snapshot of the negotiation loop taken at the end of an iteration.
+ * Only nodes whose occupancy or congestion costs differ from their initial values are stored,
+ * and the connection paths are flattened into one array, so the file stays compact for large devices.
+ */
+class RouteCheckpoint {
+public:
+	static const int version = 4; // written before the archive and checked by load(); bump it whenever serialize() changes
+
+	// design fingerprint, used to reject a checkpoint of another design/device
+	int numNodes = 0;
+	int numConns = 0;
+	int numNets = 0;
+	uint64_t connectionHash = 0;
+
+	// negotiation state
+	int iter = 0;
+	int connectionIdBase = 0;
+	float presentCongestionFactor = 0;
+	float historicalCongestionFactor = 0;
+	float presentCongestionMultiplier = 0;
+	bool isCongestedDesign = false;
+	bool useOverlapRouting = true;
+	int numOverUsedRNodes = 0;
+
+	// loop statistics driving the routing-mode switch
+	float congestRatio = 0;
+	double decreaseRatio = 0;
+	int lastOverusedNodeNum = 0;
+	float shareRatio = 0;
+	float lastShareRatio = 0;
+	int peakOverusedNodeNum = 0;  // drives the heuristic weight schedule
+	long long numUsers = 0;       // the (node, connection) uses of all nets, compared with the rebuilt ones on resume
+
+	// per-node state (sparse)
+	vector<obj_idx> nodeIds;
+	vector<int> occupancies;
+	vector<float> presentCosts;
+	vector<float> historicalCosts;
+
+	// per-connection state
+	vector<uint8_t> routed;
+	vector<uint32_t> pathOffsets; // paths of connection i: pathNodes[pathOffsets[i], pathOffsets[i + 1])
+	vector<obj_idx> pathNodes;    // from sink to source, the same order as Connection::rnodes
+	vector<int16_t> xMargins;     // bounding box margins, adapted per connection with --adaptive_bbox
+	vector<int16_t> yMargins;
+	vector<int> bboxStreaks;
+	vector<obj_idx> sinks;        // another pin than the placed sink after a pin swap (--lut_pin_swapping)
+
+	static uint64_t hashConnections(const vector<Connection>& connections);
+	void captureNodes(const utils::huge_vector<RouteNode>& routeNodes);
+	void captureConnections(const vector<Connection>& connections);
+
+	bool save(const string& fileName) const;
+	bool load(const string& fileName); // false for another version or inconsistent arrays
+	bool isConsistent() const;
+
+private:
+	friend class boost::serialization::access;
+	template<class Archive>
+	void serialize(Archive & ar, const unsigned int)
+	{
+		ar & numNodes;
+		ar & numConns;
+		ar & numNets;
+		ar & connectionHash;
+
+		ar & iter;
+		ar & connectionIdBase;
+		ar & presentCongestionFactor;
+		ar & historicalCongestionFactor;
+		ar & presentCongestionMultiplier;
+		ar & isCongestedDesign;
+		ar & useOverlapRouting;
+		ar & numOverUsedRNodes;
+
+		ar & congestRatio;
+		ar & decreaseRatio;
+		ar & lastOverusedNodeNum;
+		ar & shareRatio;
+		ar & lastShareRatio;
+		ar & peakOverusedNodeNum;
+		ar & numUsers;
+
+		ar & nodeIds;
+		ar & occupancies;
+		ar & presentCosts;
+		ar & historicalCosts;
+
+		ar & routed;
+		ar & pathOffsets;
+		ar & pathNodes;
+		ar & xMargins;
+		ar & yMargins;
+		ar & bboxStreaks;
+		ar & sinks;
+	}
+};
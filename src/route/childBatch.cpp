@@ -0,0 +1,159 @@
+#include "childBatch.h"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CHILD_BATCH_X86
+#endif
+
+// the lanes must round like the scalar costs of aStarRoute, so no multiply-add is fused where the target ISA has FMA
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+void ChildBatch::gather(RouteNode* const* children, int count)
+{
+	assert_t(count <= capacity);
+	size = count;
+	for (int i = 0; i < count; i ++) {
+		const RouteNode* child = children[i];
+		x[i] = child->getEndTileXCoordinate();
+		y[i] = child->getEndTileYCoordinate();
+		congestionCost[i] = child->getCongestionCost();
+		baseCost[i] = child->getBaseCost();
+		length[i] = child->getLength();
+	}
+}
+
+namespace {
+
+// The same operations in the same order as aStarRoute::getNodeCost and the heuristic of the kernel, lane by lane
+void evaluateScalar(ChildBatch& batch, const ChildBatch::Params& p, double parentPartialCost, int begin)
+{
+	for (int i = begin; i < batch.size; i ++) {
+		batch.inBBox[i] = batch.x[i] > p.xMinBB && batch.x[i] < p.xMaxBB && batch.y[i] > p.yMinBB && batch.y[i] < p.yMaxBB;
+		double biasCost = batch.baseCost[i] * p.biasScale * (std::fabs(batch.x[i] - p.xCenter) + std::fabs(batch.y[i] - p.yCenter));
+		double nodeCost = batch.congestionCost[i] + biasCost;
+		batch.partialCost[i] = parentPartialCost + (p.rnodeCostWeight * nodeCost + p.rnodeWLWeight * batch.length[i]);
+		double distanceToSink = std::fabs(batch.x[i] - p.sinkX) + std::fabs(batch.y[i] - p.sinkY);
+		batch.totalCost[i] = batch.partialCost[i] + p.estWeight * distanceToSink;
+	}
+}
+
+#ifdef CHILD_BATCH_X86
+__attribute__((target("avx2")))
+inline __m256d abs256(__m256d v)
+{
+	return _mm256_andnot_pd(_mm256_set1_pd(-0.0), v);
+}
+
+__attribute__((target("avx2")))
+void evaluateAVX2(ChildBatch& batch, const ChildBatch::Params& p, double parentPartialCost)
+{
+	const __m256d xMin = _mm256_set1_pd(p.xMinBB), xMax = _mm256_set1_pd(p.xMaxBB);
+	const __m256d yMin = _mm256_set1_pd(p.yMinBB), yMax = _mm256_set1_pd(p.yMaxBB);
+	const __m256d sinkX = _mm256_set1_pd(p.sinkX), sinkY = _mm256_set1_pd(p.sinkY);
+	const __m256d xCenter = _mm256_set1_pd(p.xCenter), yCenter = _mm256_set1_pd(p.yCenter);
+	const __m256d biasScale = _mm256_set1_pd(p.biasScale);
+	const __m256d costWeight = _mm256_set1_pd(p.rnodeCostWeight), wlWeight = _mm256_set1_pd(p.rnodeWLWeight), estWeight = _mm256_set1_pd(p.estWeight);
+	const __m256d parent = _mm256_set1_pd(parentPartialCost);
+
+	int i = 0;
+	for (; i + 4 <= batch.size; i += 4) {
+		__m256d x = _mm256_load_pd(batch.x + i);
+		__m256d y = _mm256_load_pd(batch.y + i);
+		__m256d inX = _mm256_and_pd(_mm256_cmp_pd(x, xMin, _CMP_GT_OQ), _mm256_cmp_pd(x, xMax, _CMP_LT_OQ));
+		__m256d inY = _mm256_and_pd(_mm256_cmp_pd(y, yMin, _CMP_GT_OQ), _mm256_cmp_pd(y, yMax, _CMP_LT_OQ));
+		int mask = _mm256_movemask_pd(_mm256_and_pd(inX, inY));
+		for (int lane = 0; lane < 4; lane ++)
+			batch.inBBox[i + lane] = (mask >> lane) & 1;
+
+		__m256d biasCost = _mm256_mul_pd(_mm256_mul_pd(_mm256_load_pd(batch.baseCost + i), biasScale),
+			_mm256_add_pd(abs256(_mm256_sub_pd(x, xCenter)), abs256(_mm256_sub_pd(y, yCenter))));
+		__m256d nodeCost = _mm256_add_pd(_mm256_load_pd(batch.congestionCost + i), biasCost);
+		__m256d partialCost = _mm256_add_pd(parent,
+			_mm256_add_pd(_mm256_mul_pd(costWeight, nodeCost), _mm256_mul_pd(wlWeight, _mm256_load_pd(batch.length + i))));
+		__m256d distanceToSink = _mm256_add_pd(abs256(_mm256_sub_pd(x, sinkX)), abs256(_mm256_sub_pd(y, sinkY)));
+		_mm256_store_pd(batch.partialCost + i, partialCost);
+		_mm256_store_pd(batch.totalCost + i, _mm256_add_pd(partialCost, _mm256_mul_pd(estWeight, distanceToSink)));
+	}
+	evaluateScalar(batch, p, parentPartialCost, i);
+}
+
+__attribute__((target("avx512f")))
+void evaluateAVX512(ChildBatch& batch, const ChildBatch::Params& p, double parentPartialCost)
+{
+	const __m512d xMin = _mm512_set1_pd(p.xMinBB), xMax = _mm512_set1_pd(p.xMaxBB);
+	const __m512d yMin = _mm512_set1_pd(p.yMinBB), yMax = _mm512_set1_pd(p.yMaxBB);
+	const __m512d sinkX = _mm512_set1_pd(p.sinkX), sinkY = _mm512_set1_pd(p.sinkY);
+	const __m512d xCenter = _mm512_set1_pd(p.xCenter), yCenter = _mm512_set1_pd(p.yCenter);
+	const __m512d biasScale = _mm512_set1_pd(p.biasScale);
+	const __m512d costWeight = _mm512_set1_pd(p.rnodeCostWeight), wlWeight = _mm512_set1_pd(p.rnodeWLWeight), estWeight = _mm512_set1_pd(p.estWeight);
+	const __m512d parent = _mm512_set1_pd(parentPartialCost);
+
+	int i = 0;
+	for (; i + 8 <= batch.size; i += 8) {
+		__m512d x = _mm512_load_pd(batch.x + i);
+		__m512d y = _mm512_load_pd(batch.y + i);
+		__mmask8 mask = _mm512_cmp_pd_mask(x, xMin, _CMP_GT_OQ) & _mm512_cmp_pd_mask(x, xMax, _CMP_LT_OQ) &
+			_mm512_cmp_pd_mask(y, yMin, _CMP_GT_OQ) & _mm512_cmp_pd_mask(y, yMax, _CMP_LT_OQ);
+		for (int lane = 0; lane < 8; lane ++)
+			batch.inBBox[i + lane] = (mask >> lane) & 1;
+
+		__m512d biasCost = _mm512_mul_pd(_mm512_mul_pd(_mm512_load_pd(batch.baseCost + i), biasScale),
+			_mm512_add_pd(_mm512_abs_pd(_mm512_sub_pd(x, xCenter)), _mm512_abs_pd(_mm512_sub_pd(y, yCenter))));
+		__m512d nodeCost = _mm512_add_pd(_mm512_load_pd(batch.congestionCost + i), biasCost);
+		__m512d partialCost = _mm512_add_pd(parent,
+			_mm512_add_pd(_mm512_mul_pd(costWeight, nodeCost), _mm512_mul_pd(wlWeight, _mm512_load_pd(batch.length + i))));
+		__m512d distanceToSink = _mm512_add_pd(_mm512_abs_pd(_mm512_sub_pd(x, sinkX)), _mm512_abs_pd(_mm512_sub_pd(y, sinkY)));
+		_mm512_store_pd(batch.partialCost + i, partialCost);
+		_mm512_store_pd(batch.totalCost + i, _mm512_add_pd(partialCost, _mm512_mul_pd(estWeight, distanceToSink)));
+	}
+	evaluateScalar(batch, p, parentPartialCost, i);
+}
+#endif
+
+void evaluatePortable(ChildBatch& batch, const ChildBatch::Params& p, double parentPartialCost)
+{
+	evaluateScalar(batch, p, parentPartialCost, 0);
+}
+
+using EvaluateFn = void (*)(ChildBatch&, const ChildBatch::Params&, double);
+
+struct Dispatch {
+	EvaluateFn evaluate = evaluatePortable;
+	const char* name = "scalar";
+
+	Dispatch() {
+#ifdef CHILD_BATCH_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f")) {
+			evaluate = evaluateAVX512;
+			name = "avx512";
+		} else if (__builtin_cpu_supports("avx2")) {
+			evaluate = evaluateAVX2;
+			name = "avx2";
+		}
+#endif
+	}
+};
+
+const Dispatch& dispatch()
+{
+	static const Dispatch instance;
+	return instance;
+}
+
+}  // namespace
+
+void ChildBatch::evaluate(const Params& params, double parentPartialCost)
+{
+	dispatch().evaluate(*this, params, parentPartialCost);
+}
+
+const char* ChildBatch::instructionSet()
+{
+	return dispatch().name;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "global.h"
+#include "db/routeNode.h"
+
+/**
+ * @brief The children of one A* expansion, evaluated together.
+ * Their attributes are gathered into arrays, then the bounding box test, the node cost and the distance to the sink
+ * are computed in SIMD lanes: AVX-512 or AVX2, picked at run time from the CPU, with a scalar fallback.
+ * The costs assume that no other connection of the net uses the child, so that the sharing factor is 1. This is the
+ * common case; the caller evaluates the other children one by one.
+ *
+ */
+struct ChildBatch {
+	static constexpr int capacity = 16;
+
+	// terms fixed during one search
+	struct Params {
+		double xMinBB, xMaxBB, yMinBB, yMaxBB; // exclusive bounds of the bounding box, as in aStarRoute::isAccessible
+		double sinkX, sinkY;
+		double biasScale, xCenter, yCenter;     // aStarRoute::BiasTerms
+		double rnodeCostWeight, rnodeWLWeight, estWeight;
+	};
+
+	int size = 0;
+	alignas(64) double x[capacity] = {};       // end tile coordinates
+	alignas(64) double y[capacity] = {};
+	alignas(64) double congestionCost[capacity] = {};
+	alignas(64) double baseCost[capacity] = {};
+	alignas(64) double length[capacity] = {};
+	alignas(64) double partialCost[capacity] = {};
+	alignas(64) double totalCost[capacity] = {};
+	bool inBBox[capacity] = {};
+
+	void gather(RouteNode* const* children, int count);
+	void evaluate(const Params& params, double parentPartialCost);
+
+	static const char* instructionSet(); // the SIMD path used on this CPU
+};
@@ -0,0 +1,206 @@
+#include "globalRouter.h"
+#include "utils/MTStat.h"
+#include <queue>
+#include <algorithm>
+#include <mutex>
+#include <functional>
+
+/**
+ * @brief Count the wires of the routing graph crossing each gcell boundary.
+ * A wire is taken as going first along x, in the gcell row where it begins, then along y, in the column where it ends.
+ *
+ */
+void GlobalRouter::buildCapacity(const utils::huge_vector<RouteNode>& routeNodes, int numNodes, int gcellSize_, int numThread)
+{
+	gcellSize = gcellSize_;
+	int maxX = 0, maxY = 0;
+	for (int id = 0; id < numNodes; id ++) {
+		const RouteNode& rnode = routeNodes[id];
+		maxX = std::max({maxX, (int)rnode.getBeginTileXCoordinate(), (int)rnode.getEndTileXCoordinate()});
+		maxY = std::max({maxY, (int)rnode.getBeginTileYCoordinate(), (int)rnode.getEndTileYCoordinate()});
+	}
+	numGCellsX = maxX / gcellSize + 1;
+	numGCellsY = maxY / gcellSize + 1;
+	int numEdges = getNumGCells() * 4;
+	capacity.assign(numEdges, 0);
+	demand.assign(numEdges, 0);
+	history.assign(numEdges, 0);
+	edgeStamps.assign(numEdges, -1);
+
+	std::mutex mutex;
+	const int chunkSize = 1 << 16;
+	int numChunks = (numNodes + chunkSize - 1) / chunkSize;
+	runJobsMT(numChunks, numThread, [&](int chunk) {
+		vector<int> wires(numEdges, 0);
+		for (int id = chunk * chunkSize; id < std::min(numNodes, (chunk + 1) * chunkSize); id ++) {
+			const RouteNode& rnode = routeNodes[id];
+			if (rnode.getNodeType() != WIRE || rnode.getChildrenSize() == 0) continue;
+			int begin = getGCell(rnode.getBeginTileXCoordinate(), rnode.getBeginTileYCoordinate());
+			int end = getGCell(rnode.getEndTileXCoordinate(), rnode.getEndTileYCoordinate());
+			int bx = begin % numGCellsX, by = begin / numGCellsX;
+			int ex = end % numGCellsX, ey = end / numGCellsX;
+			for (int x = bx; x < ex; x ++) wires[getEdge(by * numGCellsX + x, EAST)] ++;
+			for (int x = bx; x > ex; x --) wires[getEdge(by * numGCellsX + x, WEST)] ++;
+			for (int y = by; y < ey; y ++) wires[getEdge(y * numGCellsX + ex, NORTH)] ++;
+			for (int y = by; y > ey; y --) wires[getEdge(y * numGCellsX + ex, SOUTH)] ++;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		for (int e = 0; e < numEdges; e ++)
+			capacity[e] += wires[e];
+	});
+}
+
+double GlobalRouter::getEdgeCost(int edge) const
+{
+	int overuse = std::max(0, demand[edge] + 1 - capacity[edge]);
+	return (1 + history[edge]) * (1 + presentFactor * overuse);
+}
+
+/**
+ * @brief A* over the gcells of the bounding box of a connection, from the gcell of its source to the gcell of its sink.
+ *
+ * @param path the gcells from the source to the sink
+ * @return false if the sink gcell cannot be reached
+ */
+bool GlobalRouter::routeConnection(const Connection& connection, vector<int>& path)
+{
+	path.clear();
+	int source = getGCell(connection.getSourceRNode()->getEndTileXCoordinate(), connection.getSourceRNode()->getEndTileYCoordinate());
+	int sink = getGCell(connection.getSinkRNode()->getEndTileXCoordinate(), connection.getSinkRNode()->getEndTileYCoordinate());
+	int lowerLeft = getGCell(connection.getXMinBB(), connection.getYMinBB());
+	int upperRight = getGCell(connection.getXMaxBB(), connection.getYMaxBB());
+	int xMin = lowerLeft % numGCellsX, yMin = lowerLeft / numGCellsX;
+	int xMax = upperRight % numGCellsX, yMax = upperRight / numGCellsX;
+	int sinkX = sink % numGCellsX, sinkY = sink / numGCellsX;
+
+	searchLabel ++;
+	using Entry = std::pair<double, int>;
+	std::priority_queue<Entry, vector<Entry>, std::greater<Entry>> queue;
+	auto push = [&](int gcell, int prev, double cost) {
+		searchLabels[gcell] = searchLabel;
+		searchCosts[gcell] = cost;
+		searchPrevs[gcell] = prev;
+		int x = gcell % numGCellsX, y = gcell / numGCellsX;
+		queue.emplace(cost + std::abs(x - sinkX) + std::abs(y - sinkY), gcell);
+	};
+	push(source, -1, 0);
+	const int dx[4] = {1, -1, 0, 0};
+	const int dy[4] = {0, 0, 1, -1};
+	while (!queue.empty()) {
+		int gcell = queue.top().second; queue.pop();
+		if (searchClosed[gcell] == searchLabel) continue; // pushed again at a lower cost
+		searchClosed[gcell] = searchLabel;
+		if (gcell == sink) break;
+		int x = gcell % numGCellsX, y = gcell / numGCellsX;
+		double cost = searchCosts[gcell];
+		for (int direction = EAST; direction <= SOUTH; direction ++) {
+			int nx = x + dx[direction], ny = y + dy[direction];
+			if (nx < xMin || nx > xMax || ny < yMin || ny > yMax) continue;
+			int edge = getEdge(gcell, direction);
+			double newCost = cost + (edgeStamps[edge] == netPass ? sharedEdgeCost : getEdgeCost(edge));
+			int next = ny * numGCellsX + nx;
+			if (searchClosed[next] == searchLabel) continue;
+			if (searchLabels[next] != searchLabel || newCost < searchCosts[next])
+				push(next, gcell, newCost);
+		}
+	}
+	if (searchLabels[sink] != searchLabel)
+		return false;
+	for (int gcell = sink; gcell != -1; gcell = searchPrevs[gcell])
+		path.push_back(gcell);
+	std::reverse(path.begin(), path.end());
+	return true;
+}
+
+// a boundary crossed by several connections of a net counts once
+void GlobalRouter::addNetDemand(int netId, const vector<int>& path)
+{
+	for (int i = 0; i + 1 < path.size(); i ++) {
+		int from = path[i], to = path[i + 1];
+		int direction = to / numGCellsX > from / numGCellsX ? NORTH : to / numGCellsX < from / numGCellsX ? SOUTH : to > from ? EAST : WEST;
+		int edge = getEdge(from, direction);
+		if (edgeStamps[edge] == netPass) continue;
+		edgeStamps[edge] = netPass;
+		demand[edge] ++;
+		netEdges[netId].push_back(edge);
+	}
+}
+
+void GlobalRouter::ripupNet(int netId)
+{
+	for (int edge : netEdges[netId])
+		demand[edge] --;
+	netEdges[netId].clear();
+}
+
+long long GlobalRouter::getOverflow() const
+{
+	long long overflow = 0;
+	for (int e = 0; e < demand.size(); e ++)
+		overflow += std::max(0, demand[e] - capacity[e]);
+	return overflow;
+}
+
+/**
+ * @brief Route all connections on the gcells and keep the paths as corridors.
+ * After the first iteration, only the nets crossing an overused boundary are routed again.
+ *
+ */
+void GlobalRouter::route(const vector<Net>& nets, const vector<Connection>& connections)
+{
+	int numGCells = getNumGCells();
+	searchCosts.assign(numGCells, 0);
+	searchPrevs.assign(numGCells, -1);
+	searchLabels.assign(numGCells, -1);
+	searchClosed.assign(numGCells, -1);
+	netEdges.assign(nets.size(), vector<int>());
+	vector<vector<int>> paths(connections.size());
+
+	auto isOverused = [this](int netId) {
+		for (int edge : netEdges[netId])
+			if (demand[edge] > capacity[edge]) return true;
+		return false;
+	};
+	for (int iter = 0; iter < maxIterations; iter ++) {
+		int numRerouted = 0;
+		for (int netId = 0; netId < nets.size(); netId ++) {
+			if (iter > 0 && !isOverused(netId)) continue;
+			ripupNet(netId);
+			netPass ++;
+			for (int connectionId : nets[netId].getConnections()) {
+				if (routeConnection(connections[connectionId], paths[connectionId]))
+					addNetDemand(netId, paths[connectionId]);
+			}
+			numRerouted ++;
+		}
+		long long overflow = getOverflow();
+		log() << "  global iteration " << iter + 1 << ": " << numRerouted << " nets routed, overflow " << overflow << std::endl;
+		if (overflow == 0) break;
+		for (int e = 0; e < demand.size(); e ++)
+			if (demand[e] > capacity[e]) history[e] += historyFactor * (demand[e] - capacity[e]);
+		presentFactor *= 2;
+	}
+
+	corridorOffsets.assign(connections.size() + 1, 0);
+	for (int i = 0; i < connections.size(); i ++)
+		corridorOffsets[i + 1] = corridorOffsets[i] + paths[i].size();
+	corridorCells.clear();
+	corridorCells.reserve(corridorOffsets.back());
+	for (auto& path : paths)
+		corridorCells.insert(corridorCells.end(), path.begin(), path.end());
+	netEdges = vector<vector<int>>();
+	searchCosts = vector<double>();
+	searchPrevs = vector<int>();
+	searchLabels = vector<int>();
+	searchClosed = vector<int>();
+}
+
+void GlobalRouter::markCorridor(int connectionId, vector<int>& marks, int label) const
+{
+	for (int i = corridorOffsets[connectionId]; i < corridorOffsets[connectionId + 1]; i ++) {
+		int x = corridorCells[i] % numGCellsX, y = corridorCells[i] / numGCellsX;
+		for (int ny = std::max(0, y - corridorMargin); ny <= std::min(numGCellsY - 1, y + corridorMargin); ny ++)
+			for (int nx = std::max(0, x - corridorMargin); nx <= std::min(numGCellsX - 1, x + corridorMargin); nx ++)
+				marks[ny * numGCellsX + nx] = label;
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include "global.h"
+#include "db/connection.h"
+#include "db/routeNode.h"
+#include "utils/hugePage.h"
+
+/**
+ * @brief Coarse routing of all connections before the detailed A* (options.corridorIterations).
+ * The device is divided into gcells of gcellSize x gcellSize tiles. The capacity of the boundary between two neighbouring gcells,
+ * in each direction, is the number of wires of the routing graph that cross it. Connections are routed as gcell paths with
+ * negotiated congestion, net by net, so that the connections of a net share the boundaries they cross.
+ * The corridor of a connection is its gcell path widened by corridorMargin gcells.
+ *
+ */
+class GlobalRouter {
+public:
+	void buildCapacity(const utils::huge_vector<RouteNode>& routeNodes, int numNodes, int gcellSize_, int numThread);
+	void route(const vector<Net>& nets, const vector<Connection>& connections);
+
+	bool hasCorridor(int connectionId) const { return corridorOffsets[connectionId + 1] > corridorOffsets[connectionId]; }
+	// set marks[g] = label for the gcells g of the corridor; marks holds getNumGCells() entries
+	void markCorridor(int connectionId, vector<int>& marks, int label) const;
+	int getGCell(int x, int y) const {
+		int gx = std::min(std::max(x, 0) / gcellSize, numGCellsX - 1);
+		int gy = std::min(std::max(y, 0) / gcellSize, numGCellsY - 1);
+		return gy * numGCellsX + gx;
+	}
+	int getNumGCells() const { return numGCellsX * numGCellsY; }
+
+private:
+	enum Direction { EAST = 0, WEST, NORTH, SOUTH };
+	int getEdge(int gcell, int direction) const { return gcell * 4 + direction; }
+	double getEdgeCost(int edge) const;
+	bool routeConnection(const Connection& connection, vector<int>& path);
+	void addNetDemand(int netId, const vector<int>& path);
+	void ripupNet(int netId);
+	long long getOverflow() const;
+
+	int gcellSize = 4;
+	int numGCellsX = 0;
+	int numGCellsY = 0;
+	int corridorMargin = 1;      // gcells added around the path on each side
+	int maxIterations = 8;       // negotiation iterations of the coarse routing
+	double presentFactor = 0.5;  // doubled every iteration
+	double historyFactor = 1;
+	double sharedEdgeCost = 0.1; // a boundary the net already crosses
+
+	vector<int> capacity;   // per directed boundary: getEdge(gcell, direction) to the neighbour in that direction
+	vector<int> demand;     // nets crossing the boundary
+	vector<float> history;
+	vector<vector<int>> netEdges; // the boundaries each net crosses
+	vector<int> edgeStamps;       // the net pass that last counted its demand on a boundary
+	int netPass = 0;
+
+	// coarse A*, labeled per search ->
+	vector<double> searchCosts;
+	vector<int> searchPrevs;
+	vector<int> searchLabels; // pushed by the search with this label
+	vector<int> searchClosed; // popped by the search with this label
+	int searchLabel = 0;
+	// coarse A* <-
+
+	vector<int> corridorOffsets; // the gcell path of connection i is corridorCells[corridorOffsets[i] .. corridorOffsets[i + 1]), source first
+	vector<int> corridorCells;
+};
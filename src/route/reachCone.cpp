@@ -0,0 +1,60 @@
+#include "reachCone.h"
+
+std::shared_ptr<const ReachCone> ReachConeCache::find(int sinkId) const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = cones.find(sinkId);
+	return it == cones.end() ? nullptr : it->second.cone;
+}
+
+void ReachConeCache::insert(int sinkId, std::shared_ptr<const ReachCone> cone)
+{
+	size_t bytes = cone->bytes();
+	std::lock_guard<std::mutex> lock(mutex);
+	if (bytes > capacityBytes) { // would evict everything else and still not fit
+		numRejected ++;
+		return;
+	}
+	auto it = cones.find(sinkId);
+	if (it != cones.end()) { // a cone of an older, smaller bounding box
+		usedBytes -= it->second.cone->bytes();
+		cones.erase(it);
+	}
+	while (usedBytes + bytes > capacityBytes && !insertionOrder.empty()) {
+		auto [stamp, oldSinkId] = insertionOrder.front();
+		insertionOrder.pop_front();
+		auto old = cones.find(oldSinkId);
+		if (old == cones.end() || old->second.stamp != stamp) continue;
+		usedBytes -= old->second.cone->bytes();
+		cones.erase(old);
+		numEvicted ++;
+	}
+	long long stamp = nextStamp ++;
+	cones.emplace(sinkId, Entry{std::move(cone), stamp});
+	insertionOrder.emplace_back(stamp, sinkId);
+	usedBytes += bytes;
+}
+
+size_t ReachConeCache::getNumCones() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return cones.size();
+}
+
+size_t ReachConeCache::getUsedBytes() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return usedBytes;
+}
+
+int ReachConeCache::getNumEvicted() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return numEvicted;
+}
+
+int ReachConeCache::getNumRejected() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return numRejected;
+}
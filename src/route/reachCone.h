@@ -0,0 +1,62 @@
+#pragma once
+#include "global.h"
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <unordered_map>
+#include <algorithm>
+
+/**
+ * @brief The nodes from which a sink can be reached without leaving a bounding box: the reverse-reachability cone of the sink.
+ * No path from a node outside the cone reaches the sink inside the bounding box, so A* does not push it.
+ * The members are kept as sorted node ids: node ids are not ordered by location, so a bitmap over their range
+ * could take nearly a bit per node of the device for a small cone.
+ *
+ */
+struct ReachCone {
+	int xMinBB, xMaxBB, yMinBB, yMaxBB; // the (exclusive) bounding box the cone was built in
+	vector<int> members; // sorted
+
+	bool contains(int nodeId) const {
+		return std::binary_search(members.begin(), members.end(), nodeId);
+	}
+	// a cone built in a bounding box holds every node that reaches the sink in any smaller one
+	bool covers(int xMin, int xMax, int yMin, int yMax) const {
+		return xMinBB <= xMin && xMaxBB >= xMax && yMinBB <= yMin && yMaxBB >= yMax;
+	}
+	size_t bytes() const { return sizeof(ReachCone) + members.capacity() * sizeof(int); }
+};
+
+/**
+ * @brief The cones of all threads, keyed by the placed sink node, kept across connections and iterations within a memory cap.
+ * When a new cone does not fit, the oldest ones are evicted. Cones are immutable once inserted, so a search keeps
+ * using its cone even if it is evicted meanwhile.
+ *
+ */
+class ReachConeCache {
+public:
+	void setCapacity(size_t bytes) { capacityBytes = bytes; }
+	size_t getCapacity() const { return capacityBytes; }
+
+	std::shared_ptr<const ReachCone> find(int sinkId) const;
+	void insert(int sinkId, std::shared_ptr<const ReachCone> cone);
+
+	size_t getNumCones() const;
+	size_t getUsedBytes() const;
+	int getNumEvicted() const;
+	int getNumRejected() const;
+
+private:
+	struct Entry {
+		std::shared_ptr<const ReachCone> cone;
+		long long stamp; // insertion order
+	};
+	mutable std::mutex mutex;
+	std::unordered_map<int, Entry> cones;
+	std::deque<std::pair<long long, int>> insertionOrder; // (stamp, sinkId); entries of replaced cones are skipped
+	long long nextStamp = 0;
+	size_t capacityBytes = 0;
+	size_t usedBytes = 0;
+	int numEvicted = 0;
+	int numRejected = 0; // cones larger than the whole cache
+};
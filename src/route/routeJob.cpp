@@ -0,0 +1,110 @@
+#include "routeJob.h"
+#include <fstream>
+#include <atomic>
+#include <thread>
+
+/**
+ * @brief Route one design on a shared device: all per-design state lives in a local potter::Design and is released on return.
+ *
+ * @return false if job.output has unrouted pins or holds no legal solution at the end of the time budget, as the exit status 2 of a single route
+ */
+bool runRouteJob(potter::Device& device, const RouteJobSpec& job)
+{
+	auto progress = [&job](const string& message) {
+		if (job.options.onProgress)
+			job.options.onProgress(message);
+	};
+
+	utils::timer timer;
+	log() << "Route job: " << job.input << " -> " << job.output << " (" << job.numThread << " threads)" << endl;
+	progress("reading " + job.input);
+	potter::Design design(device, job.numThread);
+	design.getDatabase().setLutPinSwapping(job.options.lutPinSwapping);
+	design.readNetlist(job.input);
+
+	progress("routing");
+	bool isLegal = design.route(job.options);
+
+	progress("writing " + job.output);
+	bool isComplete = design.writeNetlist(job.output);
+	log() << "Route job finished in " << std::fixed << std::setprecision(2) << timer.elapsed() << "s" << endl;
+	if (!isComplete) {
+		log(LOG_ERROR) << job.output << " has unrouted pins." << endl;
+		return false;
+	}
+	if (!isLegal && job.options.timeBudget > 0) {
+		log(LOG_ERROR) << "No legal solution within the time budget. " << job.output << " holds the best one found." << endl;
+		return false;
+	}
+	return true;
+}
+
+/**
+ * @brief Read a batch job list: one "<input> <output>" pair per line. Empty lines and lines starting with '#' are skipped.
+ *
+ */
+bool readRouteJobs(const string& jobFile, vector<RouteJobSpec>& jobs)
+{
+	std::ifstream ifs(jobFile);
+	if (!ifs) {
+		log(LOG_ERROR) << "Cannot open job list " << jobFile << endl;
+		return false;
+	}
+	string line;
+	int lineNo = 0;
+	while (std::getline(ifs, line)) {
+		lineNo ++;
+		std::istringstream iss(line);
+		RouteJobSpec job;
+		if (!(iss >> job.input) || job.input[0] == '#')
+			continue;
+		if (!(iss >> job.output)) {
+			log(LOG_ERROR) << jobFile << ":" << lineNo << ": missing output netlist for " << job.input << endl;
+			return false;
+		}
+		jobs.emplace_back(job);
+	}
+	return true;
+}
+
+/**
+ * @brief Route a list of designs on one device. numParallelJobs designs are routed at the same time, each with an equal share of numThread.
+ * The per-design state is separate for every job, so a failed job does not affect the others.
+ *
+ * @return 0 if every job is routed, 2 otherwise
+ */
+int runRouteBatch(potter::Device& device, vector<RouteJobSpec>& jobs, int numThread, int numParallelJobs)
+{
+	numParallelJobs = std::max(1, std::min(numParallelJobs, (int)jobs.size()));
+	int numThreadPerJob = std::max(1, numThread / numParallelJobs);
+	log() << "Batch: " << jobs.size() << " jobs, " << numParallelJobs << " at a time with " << numThreadPerJob << " threads each" << endl;
+
+	utils::timer timer;
+	vector<uint8_t> success(jobs.size(), 0);
+	std::atomic<int> nextJob(0);
+	auto worker = [&]() {
+		for (int i = nextJob ++; i < jobs.size(); i = nextJob ++) {
+			jobs[i].numThread = numThreadPerJob;
+			try {
+				success[i] = runRouteJob(device, jobs[i]);
+			} catch (const std::exception& e) {
+				log(LOG_ERROR) << "Route job " << jobs[i].input << " failed: " << e.what() << endl;
+			}
+		}
+	};
+	vector<std::thread> workers;
+	for (int i = 0; i < numParallelJobs; i ++)
+		workers.emplace_back(worker);
+	for (auto& w : workers)
+		w.join();
+
+	int numFailed = 0;
+	for (int i = 0; i < jobs.size(); i ++) {
+		if (!success[i]) {
+			numFailed ++;
+			log(LOG_ERROR) << "Not routed: " << jobs[i].input << endl;
+		}
+	}
+	log() << "Batch finished: " << jobs.size() - numFailed << " / " << jobs.size() << " routed in " << std::fixed << std::setprecision(2) << timer.elapsed() << "s" << endl;
+	return numFailed == 0 ? 0 : 2;
+}
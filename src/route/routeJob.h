@@ -0,0 +1,22 @@
+#pragma once
+#include "global.h"
+#include "api/potter.h"
+#include "routeOptions.h"
+
+/**
+ * @brief One design to be routed on an already loaded device
+ *
+ */
+struct RouteJobSpec {
+	string input;
+	string output;
+	int numThread = 32;
+	RouteOptions options;
+};
+
+bool runRouteJob(potter::Device& device, const RouteJobSpec& job);
+
+// batch mode ->
+bool readRouteJobs(const string& jobFile, vector<RouteJobSpec>& jobs);
+int runRouteBatch(potter::Device& device, vector<RouteJobSpec>& jobs, int numThread, int numParallelJobs);
+// batch mode <-
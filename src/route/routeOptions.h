@@ -0,0 +1,38 @@
+#pragma once
+#include "global.h"
+#include <functional>
+
+/**
+ * @brief User-facing settings of the router. They are filled from the command line in main() and handed to aStarRoute.
+ *
+ */
+struct RouteOptions {
+	bool isRuntimeFirst = false;
+
+	// checkpoint & resume ->
+	string checkpointFile = "";   // empty: checkpointing disabled
+	int checkpointInterval = 5;   // number of negotiation iterations between two checkpoints
+	bool resume = false;          // continue from checkpointFile if it matches the design
+	// checkpoint & resume <-
+
+	double timeBudget = 0;        // wall-clock seconds for route(); 0: unlimited
+	bool adaptiveBBox = false;    // per-connection bounding box margins that grow on failure or persistent congestion and shrink after convergence
+	bool multiSource = false;     // route later connections of a net from the net's routed tree, not only from its source
+	double heuristicWeightStart = 0; // inflated A* heuristic weight of the first iterations, relaxed to the default as the overuse drops; 0: fixed weight
+	bool adaptiveHeuristic = false;  // raise the heuristic weight of connections whose last search popped many nodes
+	bool lutPinSwapping = false;  // let a LUT input sink end at a free input of the same LUT; the netlist must be read with Database::setLutPinSwapping
+	int netTreeFanout = 0;        // nets with at least this many connections are ordered like Prim's tree and rebuilt as a whole; 0: disabled
+	bool costBound = false;       // bound the reroute of a connection by the cost of its old path, kept if nothing cheaper is found
+	double costBoundSlack = 0.1;  // relative slack of the bound, for the distance estimate along the old path
+	bool partialRipup = false;    // reroute only the congested window of a routed connection before falling back to a full reroute
+	int bidirectionalHpwl = 0;    // search connections with at least this HPWL (in tiles) from both ends; 0: disabled
+	int prefetchDistance = 4;     // children prefetched ahead of the one being evaluated in A* expansions; 0: no software prefetch
+	bool batchExpansion = true;   // evaluate the children of an A* expansion in SIMD batches
+	int sparseIterations = 0;     // first iterations searched on a graph that keeps the cheapest wires per direction and length; 0: disabled
+	int corridorIterations = 0;   // first iterations searched in the corridor of a coarse global route of the connection; 0: disabled
+	int gcellSize = 4;            // width in tiles of the cells of the coarse global routing grid
+	int reachConeMB = 0;          // memory cap of the cached sink reachability cones that prune A*; 0: disabled
+	bool traceSearch = false;     // count the A* expansions and log them per iteration
+
+	std::function<void(const string& message)> onProgress; // optional, receives one line per negotiation iteration
+};
@@ -24,13 +24,16 @@ void aStarRoute::runtimeFirstParallelRouting() {
 
 		for (int netId: netIds) {
 			assert_t(netId >= 0 && netId < database.nets.size());
+			if (!netTreeOrders.empty() && !netTreeOrders[netId].empty()) {
+				routeNetTree(netId, tid);
+				continue;
+			}
 			vector<int> connectionIds = database.nets[netId].getConnections();
 			std::sort(connectionIds.begin(), connectionIds.end(), connCompare);
 			for (int connectionId: connectionIds) {
 				auto& connection = database.indirectConnections[connectionId];
 				if (shouldRoute(connection)) {
-					ripup(connection, false);
-					bool success = routeOneConnection(connectionId, tid, false);
+					bool success = rerouteConnection(connectionId, tid, options.multiSource);
 					if (!success) {
 						log() << "Routing failure. Connection "<< connection << " Coordinate: [" << connection.getSourceRNode()->getEndTileXCoordinate() << " " << connection.getSinkRNode()->getEndTileXCoordinate() << " " << connection.getSourceRNode()->getEndTileYCoordinate() << " " << connection.getSinkRNode()->getEndTileYCoordinate() << "] " << std::endl;
 					}
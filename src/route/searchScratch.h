@@ -0,0 +1,58 @@
+#pragma once
+#include "global.h"
+#include "db/routeNode.h"
+#include "childBatch.h"
+#include <algorithm>
+
+/**
+ * @brief A binary heap kept in a borrowed vector, with the interface of std::priority_queue.
+ * The vector is cleared, not freed, so its capacity carries over to the next search.
+ *
+ */
+template <typename T, typename Compare>
+class HeapView {
+public:
+	HeapView(vector<T>& heap_, Compare comp_) : heap(heap_), comp(comp_) { heap.clear(); }
+
+	bool empty() const { return heap.empty(); }
+	size_t size() const { return heap.size(); }
+	const T& top() const { return heap.front(); }
+
+	void push(const T& value) {
+		heap.push_back(value);
+		std::push_heap(heap.begin(), heap.end(), comp);
+	}
+	template <typename... Args>
+	void emplace(Args&&... args) {
+		heap.emplace_back(std::forward<Args>(args)...);
+		std::push_heap(heap.begin(), heap.end(), comp);
+	}
+	void pop() {
+		std::pop_heap(heap.begin(), heap.end(), comp);
+		heap.pop_back();
+	}
+
+private:
+	vector<T>& heap;
+	Compare comp;
+};
+
+/**
+ * @brief Buffers of the searches of one thread, reused by every connection the thread routes.
+ * A search allocates only when it outgrows the largest search of the thread so far.
+ *
+ */
+struct SearchScratch {
+	using KeyedNode = std::pair<double, RouteNode*>;
+
+	vector<RouteNode*> forwardHeap; // open list of the A* kernel, ordered by NodeInfo::cost
+	vector<KeyedNode> keyedHeap;    // open list of the backward search (bidirectional) and of the partial rip-up search
+	vector<RouteNode*> path;        // a connection path being rebuilt
+	vector<RouteNode*> oldPath;     // the path a bounded reroute falls back to
+	ChildBatch batch;               // the children of the node being expanded
+	vector<int> corridorMarks;      // per gcell: the label of the last search whose corridor holds it
+
+	size_t capacityBytes() const {
+		return forwardHeap.capacity() * sizeof(RouteNode*) + keyedHeap.capacity() * sizeof(KeyedNode) + (path.capacity() + oldPath.capacity()) * sizeof(RouteNode*) + corridorMarks.capacity() * sizeof(int);
+	}
+};
@@ -65,7 +65,7 @@ void aStarRoute::routeWorker(vector<int>& netIds, int tid) {
 		net.clearPreIncrement();
 		// store used rnodes before this iteration
 		unordered_set<RouteNode*> usedRNodesBefore;
-		vector<int> connectionIds = net.getConnections();
+		const vector<int>& connectionIds = net.getConnectionsByRef();
 		for (int connectionId: connectionIds) {
 			auto& connection = database.indirectConnections[connectionId];
 			for (RouteNode* rnode: connection.getRNodes()) {
@@ -73,14 +73,29 @@ void aStarRoute::routeWorker(vector<int>& netIds, int tid) {
 			}
 		}
 		// routing
-		for (int connectionId: connectionIds) {
+		// a net routed as a tree (options.netTreeFanout) is ripped up as a whole and rebuilt in its Prim order, see routeNetTree()
+		bool isTreeNet = !netTreeOrders.empty() && !netTreeOrders[netId].empty();
+		const vector<int>& routingOrder = isTreeNet ? netTreeOrders[netId] : connectionIds;
+		bool rebuildTree = false;
+		if (isTreeNet) {
+			for (int connectionId: routingOrder)
+				rebuildTree = rebuildTree || shouldRoute(database.indirectConnections[connectionId]);
+		}
+		if (rebuildTree) {
+			for (int connectionId: routingOrder)
+				ripup(database.indirectConnections[connectionId], true);
+			if (options.traceSearch)
+				searchTraceForThreads[tid].netTrees ++;
+		}
+		for (int connectionId: routingOrder) {
 			auto& connection = database.indirectConnections[connectionId];
 			connection.setRoutedThisIter(false);
-			if (shouldRoute(connection)) {
+			if (rebuildTree || shouldRoute(connection)) {
 				// Only pre-decrement the number of users. Do not modify global data in routeNetsOverlap
-				ripup(connection, true);
+				if (!rebuildTree)
+					ripup(connection, true);
 				// Only pre-increment the number of users but not save the routing results.
-				bool success = routeOneConnection(connectionId, tid, true);
+				bool success = routeOneConnection(connectionId, tid, true, options.multiSource || isTreeNet);
 				if (!success) {
 					log() << "Routing failure. Connection "<< connection << " Coordinate: [" << connection.getSourceRNode()->getEndTileXCoordinate() << " " << connection.getSinkRNode()->getEndTileXCoordinate() << " " << connection.getSourceRNode()->getEndTileYCoordinate() << " " << connection.getSinkRNode()->getEndTileYCoordinate() << "] " << std::endl;
 				}
@@ -127,11 +142,13 @@ void aStarRoute::updateNetsWorker(vector<int>& netIds, int tid) {
 };
 
 void aStarRoute::updatePresentCongCostWorker(int tid) {
-	std::vector<RouteNode>& routeNodes = database.routingGraph.routeNodes;
+	auto& routeNodes = database.routingGraph.routeNodes;
 	for (int rnodeId = tid; rnodeId < database.numNodes; rnodeId += numThread) {
 		RouteNode& rnode = routeNodes[rnodeId];
 		if (rnode.getNeedUpdateBatchStamp() == currentBatchStamp) {
 			rnode.updatePresentCongestionCost(presentCongestionFactor);
+			if (rnode.isOverUsed())
+				flagUsersOfNode(&rnode);
 		}
 	}
 }
@@ -0,0 +1,178 @@
+#include "routeService.h"
+#include "rpc/routeService.capnp.h"
+#include <capnp/ez-rpc.h>
+#include <kj/async.h>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+struct RouteJobOutcome {
+	bool success = false;
+	string message;
+	double seconds = 0;
+};
+
+/**
+ * @brief Serves route requests on a device loaded once.
+ * Each job runs on its own thread so that the event loop keeps forwarding progress; jobs are executed one at a time, each with all threads.
+ */
+class RouteServiceImpl final : public RouteRpc::RouteService::Server {
+public:
+	RouteServiceImpl(potter::Device& device_, int numThread_) : device(device_), numThread(numThread_) {}
+
+protected:
+	kj::Promise<void> route(RouteContext context) override
+	{
+		auto params = context.getParams();
+		auto job = params.getJob();
+		RouteJobSpec spec;
+		spec.input = job.getInput();
+		spec.output = job.getOutput();
+		spec.numThread = job.getNumThread() > 0 ? job.getNumThread() : numThread;
+		spec.options.isRuntimeFirst = job.getRuntimeFirst();
+		spec.options.timeBudget = job.getTimeBudget();
+		spec.options.checkpointFile = job.getCheckpoint();
+		spec.options.checkpointInterval = job.getCheckpointInterval();
+		spec.options.resume = job.getResume();
+		spec.options.traceSearch = job.getTraceSearch();
+		spec.options.multiSource = job.getMultiSource();
+		spec.options.adaptiveBBox = job.getAdaptiveBBox();
+		spec.options.bidirectionalHpwl = job.getBidirectionalHpwl();
+		spec.options.partialRipup = job.getPartialRipup();
+		spec.options.heuristicWeightStart = job.getHeuristicWeightStart();
+		spec.options.adaptiveHeuristic = job.getAdaptiveHeuristic();
+		spec.options.prefetchDistance = job.getPrefetchDistance();
+		spec.options.batchExpansion = job.getBatchExpansion();
+		spec.options.reachConeMB = job.getReachConeMB();
+		spec.options.sparseIterations = job.getSparseIterations();
+		spec.options.costBound = job.getCostBound();
+		spec.options.costBoundSlack = job.getCostBoundSlack();
+		spec.options.netTreeFanout = job.getNetTreeFanout();
+		spec.options.lutPinSwapping = job.getLutPinSwapping();
+		spec.options.corridorIterations = job.getCorridorIterations();
+		spec.options.gcellSize = job.getGcellSize();
+
+		// the client capability stays on the event loop thread; the routing thread only posts messages to it
+		auto sink = kj::heap<RouteRpc::ProgressSink::Client>(params.getProgress());
+		RouteRpc::ProgressSink::Client* sinkPtr = sink.get();
+		const kj::Executor& executor = kj::getCurrentThreadExecutor();
+		spec.options.onProgress = [&executor, sinkPtr](const string& message) {
+			executor.executeSync([sinkPtr, &message]() {
+				auto request = sinkPtr->reportRequest();
+				request.setMessage(message);
+				request.send().detach([](kj::Exception&&) {}); // a client that went away must not abort the job
+			});
+		};
+
+		auto paf = kj::newPromiseAndCrossThreadFulfiller<RouteJobOutcome>();
+		// std::thread needs a noexcept destructor of its callable, which kj::Own does not have
+		auto fulfiller = std::make_shared<kj::Own<kj::CrossThreadPromiseFulfiller<RouteJobOutcome>>>(kj::mv(paf.fulfiller));
+		std::thread([this, spec, fulfiller]() {
+			std::lock_guard<std::mutex> lock(jobMutex);
+			RouteJobOutcome outcome;
+			utils::timer timer;
+			try {
+				outcome.success = runRouteJob(device, spec);
+				outcome.message = outcome.success ? "routed" : "unrouted pins or no legal routing solution";
+			} catch (const std::exception& e) {
+				log(LOG_ERROR) << "Route job " << spec.input << " failed: " << e.what() << endl;
+				outcome.message = e.what();
+			}
+			outcome.seconds = timer.elapsed();
+			(*fulfiller)->fulfill(kj::mv(outcome));
+		}).detach();
+
+		return paf.promise.then([context, sink = kj::mv(sink)](RouteJobOutcome&& outcome) mutable {
+			auto result = context.getResults().initResult();
+			result.setSuccess(outcome.success);
+			result.setMessage(outcome.message);
+			result.setSeconds(outcome.seconds);
+		});
+	}
+
+private:
+	potter::Device& device;
+	int numThread;
+	std::mutex jobMutex;
+};
+
+class ProgressPrinter final : public RouteRpc::ProgressSink::Server {
+protected:
+	kj::Promise<void> report(ReportContext context) override
+	{
+		log() << "[daemon] " << context.getParams().getMessage().cStr() << endl;
+		return kj::READY_NOW;
+	}
+};
+
+}
+
+/**
+ * @brief Load the device once and serve route requests on a Unix socket until the process is killed
+ *
+ */
+int serveRouteJobs(const string& socketPath, const string& deviceName, const string& imageFile, int numThread)
+{
+	potter::Device device(deviceName, imageFile);
+	unlink(socketPath.c_str()); // stale socket of a previous daemon
+
+	capnp::EzRpcServer server(kj::heap<RouteServiceImpl>(device, numThread), ("unix:" + socketPath).c_str());
+	auto& waitScope = server.getWaitScope();
+	log() << "Router daemon is listening on " << socketPath << endl;
+	kj::NEVER_DONE.wait(waitScope);
+	return 0;
+}
+
+/**
+ * @brief Send one job to a router daemon and print its progress until the job is done
+ *
+ * @return the exit code of the job (0: routed, 1: daemon unreachable, 2: no legal solution)
+ */
+int submitRouteJob(const string& socketPath, const RouteJobSpec& job)
+{
+	try {
+		capnp::EzRpcClient client(("unix:" + socketPath).c_str());
+		auto service = client.getMain<RouteRpc::RouteService>();
+		auto request = service.routeRequest();
+		auto rjob = request.initJob();
+		// the daemon may run in another working directory
+		rjob.setInput(std::filesystem::absolute(job.input).string());
+		rjob.setOutput(std::filesystem::absolute(job.output).string());
+		rjob.setNumThread(job.numThread);
+		rjob.setRuntimeFirst(job.options.isRuntimeFirst);
+		rjob.setTimeBudget(job.options.timeBudget);
+		rjob.setTraceSearch(job.options.traceSearch);
+		rjob.setMultiSource(job.options.multiSource);
+		rjob.setAdaptiveBBox(job.options.adaptiveBBox);
+		rjob.setBidirectionalHpwl(job.options.bidirectionalHpwl);
+		rjob.setPartialRipup(job.options.partialRipup);
+		rjob.setHeuristicWeightStart(job.options.heuristicWeightStart);
+		rjob.setAdaptiveHeuristic(job.options.adaptiveHeuristic);
+		rjob.setPrefetchDistance(job.options.prefetchDistance);
+		rjob.setBatchExpansion(job.options.batchExpansion);
+		rjob.setReachConeMB(job.options.reachConeMB);
+		rjob.setSparseIterations(job.options.sparseIterations);
+		rjob.setCostBound(job.options.costBound);
+		rjob.setCostBoundSlack(job.options.costBoundSlack);
+		rjob.setNetTreeFanout(job.options.netTreeFanout);
+		rjob.setLutPinSwapping(job.options.lutPinSwapping);
+		rjob.setCorridorIterations(job.options.corridorIterations);
+		rjob.setGcellSize(job.options.gcellSize);
+		if (!job.options.checkpointFile.empty())
+			rjob.setCheckpoint(std::filesystem::absolute(job.options.checkpointFile).string());
+		rjob.setCheckpointInterval(job.options.checkpointInterval);
+		rjob.setResume(job.options.resume);
+		request.setProgress(kj::heap<ProgressPrinter>());
+
+		auto response = request.send().wait(client.getWaitScope());
+		auto result = response.getResult();
+		log() << "Daemon: " << result.getMessage().cStr() << " in " << std::fixed << std::setprecision(2) << result.getSeconds() << "s" << endl;
+		return result.getSuccess() ? 0 : 2;
+	} catch (const kj::Exception& e) {
+		log(LOG_ERROR) << "Route daemon at " << socketPath << " failed: " << e.getDescription().cStr() << endl;
+		return 1;
+	}
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include "global.h"
+#include "route/routeJob.h"
+
+// router daemon ->
+int serveRouteJobs(const string& socketPath, const string& deviceName, const string& imageFile, int numThread);
+int submitRouteJob(const string& socketPath, const RouteJobSpec& job);
+// router daemon <-
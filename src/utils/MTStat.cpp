@@ -2,14 +2,19 @@
 #include <thread>
 #include <mutex>
 
-MTStat runJobsMT(int numJobs, int numThreads_, const std::function<void(int)>& handle) 
+MTStat runJobsMT(int numJobs, int numThreads, const std::function<void(int)>& handle)
+{
+    return runJobsMT(numJobs, numThreads, [&handle](int jobIdx, int) { handle(jobIdx); });
+}
+
+MTStat runJobsMT(int numJobs, int numThreads_, const std::function<void(int, int)>& handle) 
 {
     int numThreads = std::min(numJobs, numThreads_);
     MTStat mtStat(std::max(1, numThreads_));
     if (numThreads <= 1) {
         utils::timer threadTimer;
         for (int i = 0; i < numJobs; ++i) {
-            handle(i);
+            handle(i, 0);
         }
         mtStat.durations[0] = threadTimer.elapsed();
     } else {
@@ -26,7 +31,7 @@ MTStat runJobsMT(int numJobs, int numThreads_, const std::function<void(int)>& h
                     mtStat.durations[threadIdx] = threadTimer.elapsed();
                     break;
                 }
-                handle(jobIdx);
+                handle(jobIdx, threadIdx);
             }
         };
 
@@ -12,4 +12,6 @@ public:
     friend std::ostream& operator<<(std::ostream& os, const MTStat mtStat);
 };
 
-MTStat runJobsMT(int numJobs, int numThreads, const std::function<void(int)>& handle);
\ No newline at end of file
+MTStat runJobsMT(int numJobs, int numThreads, const std::function<void(int)>& handle);
+// the same, and the handle also gets the index of the executing thread (0 .. numThreads - 1) for per-thread data
+MTStat runJobsMT(int numJobs, int numThreads, const std::function<void(int jobIdx, int threadIdx)>& handle);
\ No newline at end of file
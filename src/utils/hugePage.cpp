@@ -0,0 +1,183 @@
+#include "hugePage.h"
+#include "log.h"
+
+#include <atomic>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <new>
+#include <sstream>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
+namespace utils {
+namespace huge_pages {
+
+namespace {
+
+constexpr size_t size_2m = 2UL << 20;
+constexpr size_t size_1g = 1UL << 30;
+
+struct region {
+    size_t length;      // mapped length
+    size_t bytes;       // requested length
+    bool explicit_pages;
+};
+
+std::atomic<mode> current_mode{mode::transparent};
+std::mutex regions_mutex;
+std::map<uintptr_t, region> regions;
+bool explicit_failure_logged = false;
+
+size_t round_up(size_t bytes, size_t align) { return (bytes + align - 1) / align * align; }
+
+#if defined(__linux__)
+// 2 MB aligned anonymous mapping, so that THP can back it from the first byte
+void* map_aligned(size_t length) {
+    size_t padded = length + size_2m;
+    void* p = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return nullptr;
+    uintptr_t begin = reinterpret_cast<uintptr_t>(p);
+    uintptr_t aligned = round_up(begin, size_2m);
+    if (aligned > begin) munmap(p, aligned - begin);
+    size_t tail = begin + padded - (aligned + length);
+    if (tail > 0) munmap(reinterpret_cast<void*>(aligned + length), tail);
+    return reinterpret_cast<void*>(aligned);
+}
+#endif
+
+}  // namespace
+
+bool parse_mode(const std::string& name, mode& m) {
+    if (name == "off")
+        m = mode::off;
+    else if (name == "thp")
+        m = mode::transparent;
+    else if (name == "2m")
+        m = mode::explicit_2m;
+    else if (name == "1g")
+        m = mode::explicit_1g;
+    else
+        return false;
+    return true;
+}
+
+void set_mode(mode m) { current_mode.store(m); }
+mode get_mode() { return current_mode.load(); }
+
+void* allocate(size_t bytes) {
+#if defined(__linux__)
+    mode m = get_mode();
+    void* p = nullptr;
+    region r{round_up(bytes, size_2m), bytes, false};
+    if (m == mode::explicit_2m || m == mode::explicit_1g) {
+        size_t page = (m == mode::explicit_1g) ? size_1g : size_2m;
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | ((m == mode::explicit_1g) ? MAP_HUGE_1GB : MAP_HUGE_2MB);
+        p = mmap(nullptr, round_up(bytes, page), PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (p != MAP_FAILED) {
+            r.length = round_up(bytes, page);
+            r.explicit_pages = true;
+        } else {
+            p = nullptr;
+            std::lock_guard<std::mutex> lock(regions_mutex);
+            if (!explicit_failure_logged) {
+                explicit_failure_logged = true;
+                log(LOG_WARN) << "Explicit huge pages are not available (check vm.nr_hugepages). Fall back to transparent huge pages." << std::endl;
+            }
+        }
+    }
+    if (p == nullptr) {
+        p = map_aligned(r.length);
+        if (p == nullptr) throw std::bad_alloc();
+        if (m != mode::off) madvise(p, r.length, MADV_HUGEPAGE);  // a kernel without THP ignores or rejects it; both are fine
+    }
+    std::lock_guard<std::mutex> lock(regions_mutex);
+    regions[reinterpret_cast<uintptr_t>(p)] = r;
+    return p;
+#else
+    return ::operator new(bytes, std::align_val_t(size_2m));
+#endif
+}
+
+void deallocate(void* ptr, size_t bytes) {
+#if defined(__linux__)
+    size_t length = round_up(bytes, size_2m);
+    {
+        std::lock_guard<std::mutex> lock(regions_mutex);
+        auto it = regions.find(reinterpret_cast<uintptr_t>(ptr));
+        if (it != regions.end()) {
+            length = it->second.length;
+            regions.erase(it);
+        }
+    }
+    munmap(ptr, length);
+#else
+    ::operator delete(ptr, std::align_val_t(size_2m));
+#endif
+}
+
+void report() {
+#if defined(__linux__)
+    size_t total = 0, explicit_bytes = 0, advised = 0, transparent = 0;
+    std::map<uintptr_t, region> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(regions_mutex);
+        snapshot = regions;
+    }
+    for (const auto& entry : snapshot) {
+        total += entry.second.bytes;
+        if (entry.second.explicit_pages)
+            explicit_bytes += entry.second.length;
+        else
+            advised += entry.second.length;
+    }
+    // THP is granted at fault time, so the only reliable answer is the AnonHugePages of the mappings
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    bool inRegion = false;
+    while (std::getline(smaps, line)) {
+        uintptr_t begin, end;
+        char dash;
+        // a mapping header is "begin-end perms ...", the fields that follow are "Name: value"
+        if (line.find('-') < line.find(' ') && std::istringstream(line) >> std::hex >> begin >> dash >> end) {
+            inRegion = false;
+            auto it = snapshot.upper_bound(begin);
+            if (it != snapshot.begin()) {
+                auto prev = std::prev(it);
+                inRegion = !prev->second.explicit_pages && prev->first + prev->second.length > begin;
+            }
+            if (!inRegion && it != snapshot.end()) inRegion = !it->second.explicit_pages && it->first < end;
+            continue;
+        }
+        if (inRegion && line.compare(0, 14, "AnonHugePages:") == 0) {
+            size_t kb = 0;
+            std::istringstream(line.substr(14)) >> kb;
+            transparent += kb << 10;
+        }
+    }
+    std::string thp;
+    std::ifstream thpSetting("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::getline(thpSetting, thp);
+    auto mb = [](size_t bytes) { return bytes >> 20; };
+    log() << "Huge pages: " << snapshot.size() << " large arrays, " << mb(total) << " MB; explicit " << mb(explicit_bytes)
+          << " MB, transparent " << mb(transparent) << " of " << mb(advised) << " MB" << std::endl;
+    if (get_mode() != mode::off && advised > 0 && transparent == 0)
+        log(LOG_WARN) << "No transparent huge pages were granted (THP setting: " << thp << ")" << std::endl;
+#endif
+}
+
+}  // namespace huge_pages
+}  // namespace utils
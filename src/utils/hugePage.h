@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace utils {
+
+// Huge-page backed allocation for the large, randomly accessed arrays (routing graph, per-thread search arrays)
+//
+// Arrays of at least huge_pages::min_bytes are mmap-ed on their own, 2 MB aligned, and
+//   - "thp": madvise(MADV_HUGEPAGE) so that the kernel backs them with transparent huge pages,
+//   - "2m" / "1g": explicit MAP_HUGETLB pages from the hugetlbfs pool, falling back to "thp" when the pool is empty,
+//   - "off": plain mmap.
+// Smaller arrays go to the regular heap.
+
+namespace huge_pages {
+
+enum class mode { off, transparent, explicit_2m, explicit_1g };
+
+constexpr size_t min_bytes = 2UL << 20;
+
+bool parse_mode(const std::string& name, mode& m);
+void set_mode(mode m);  // affects the allocations made afterwards
+mode get_mode();
+
+void* allocate(size_t bytes);
+void deallocate(void* ptr, size_t bytes);
+
+// log how much of the large arrays is actually backed by huge pages
+void report();
+
+}  // namespace huge_pages
+
+template <typename T>
+class huge_page_allocator {
+public:
+    using value_type = T;
+    using is_always_equal = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+
+    huge_page_allocator() noexcept = default;
+    template <typename U>
+    huge_page_allocator(const huge_page_allocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        if (n * sizeof(T) < huge_pages::min_bytes) return std::allocator<T>().allocate(n);
+        return static_cast<T*>(huge_pages::allocate(n * sizeof(T)));
+    }
+    void deallocate(T* p, size_t n) noexcept {
+        if (n * sizeof(T) < huge_pages::min_bytes)
+            std::allocator<T>().deallocate(p, n);
+        else
+            huge_pages::deallocate(p, n * sizeof(T));
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const huge_page_allocator<T>&, const huge_page_allocator<U>&) { return true; }
+template <typename T, typename U>
+bool operator!=(const huge_page_allocator<T>&, const huge_page_allocator<U>&) { return false; }
+
+template <typename T>
+using huge_vector = std::vector<T, huge_page_allocator<T>>;
+
+}  // namespace utils